@@ -17,7 +17,10 @@ namespace GearHead{
     void Application::Run(){
 		
 
+		uint64_t frame = 0;
 		while (window->ShouldClose()) {
+			GEARHEAD_PROFILE_SCOPE("Frame");
+			Log::SetFrame(frame++);
 			window->OnUpdate();
 		}
 		
@@ -1,6 +1,7 @@
 #pragma once
 #include "Core.hpp"
 #include "Window.hpp"
+#include "Profiler.hpp"
 
 
 namespace GearHead {
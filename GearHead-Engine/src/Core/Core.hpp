@@ -55,6 +55,7 @@
 	#define GEARHEAD_VKSUCCESS_CHECK(x) { auto res = x; \
 						if(res != 0) { \
 						GEARHEAD_CORE_ERROR("VK Check Failed! Error Code: {0}", static_cast<int>(res));\
+						 ::GearHead::Log::Drain();\
 						 abort();}\
 	}
 #endif
@@ -3,8 +3,10 @@
 #include <stdexcept>
 #include <cstdlib>
 #include "Application.hpp"
+#include "ThreadPool.hpp"
+#include "Tools.hpp"
 
-#ifdef GEARHEAD_PLATFORM_WINDOWS
+#if defined(GEARHEAD_PLATFORM_WINDOWS) || defined(GEARHEAD_PLATFORM_UNIX)
 
 extern GearHead::Application* GearHead::CreateApplication();
 
@@ -13,6 +15,16 @@ int main( int argc, char** argv) {
     GearHead::Log::Init();
     GEARHEAD_CORE_WARN("Initialized Log");
 
+    GearHead::Profiler::Init();
+
+    // offline tools such as the asset cook run instead of the application
+    int toolResult = EXIT_SUCCESS;
+    if (GearHead::RunTool(argc, argv, toolResult)) {
+        GearHead::ThreadPool::Get().Shutdown();
+        GearHead::Log::Shutdown();
+        return toolResult;
+    }
+
     auto app = GearHead::CreateApplication();
 	try {
 		app->Run();
@@ -20,9 +32,16 @@ int main( int argc, char** argv) {
 	}
 	catch (const std::exception& e) {
 		std::cerr << e.what() << std::endl;
+		// workers can still be logging until the pool is joined
+		delete app;
+		GearHead::ThreadPool::Get().Shutdown();
+		GearHead::Log::Shutdown();
 		return EXIT_FAILURE;
 	}
     delete app;
+
+    GearHead::ThreadPool::Get().Shutdown();
+    GearHead::Log::Shutdown();
 }
 
 
@@ -0,0 +1,153 @@
+#include "ghpch.hpp"
+
+#include "FileWatcher.hpp"
+#include "Profiler.hpp"
+
+#ifdef GEARHEAD_PLATFORM_UNIX
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace GearHead {
+
+	FileWatcher::~FileWatcher()
+	{
+		Stop();
+	}
+
+	bool FileWatcher::Start(const std::string& directory, std::vector<std::string> extensions)
+	{
+		Stop();
+
+		std::error_code ec;
+		if (!std::filesystem::is_directory(directory, ec)) {
+			GEARHEAD_CORE_WARN("Not watching {0}, no such directory", directory);
+			return false;
+		}
+
+		m_Directory = directory;
+		m_Extensions = std::move(extensions);
+		m_Stopping = false;
+
+#ifdef GEARHEAD_PLATFORM_UNIX
+		m_NotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		// editors either write in place or write a temp file and rename it over
+		if (m_NotifyFd >= 0 && inotify_add_watch(m_NotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) >= 0) {
+			m_Thread = std::thread(&FileWatcher::WatchNotify, this);
+			GEARHEAD_CORE_INFO("Watching {0} (inotify)", directory);
+			return true;
+		}
+
+		GEARHEAD_CORE_WARN("inotify unavailable for {0}, falling back to polling", directory);
+		if (m_NotifyFd >= 0) {
+			close(m_NotifyFd);
+			m_NotifyFd = -1;
+		}
+#endif
+
+		m_Thread = std::thread(&FileWatcher::WatchPolling, this);
+		GEARHEAD_CORE_INFO("Watching {0} (polling)", directory);
+		return true;
+	}
+
+	void FileWatcher::Stop()
+	{
+		if (!m_Thread.joinable())
+			return;
+
+		m_Stopping = true;
+		m_Thread.join();
+
+#ifdef GEARHEAD_PLATFORM_UNIX
+		if (m_NotifyFd >= 0) {
+			close(m_NotifyFd);
+			m_NotifyFd = -1;
+		}
+#endif
+	}
+
+	std::vector<std::string> FileWatcher::PollChanges()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		std::vector<std::string> changed(m_Changed.begin(), m_Changed.end());
+		m_Changed.clear();
+		return changed;
+	}
+
+	bool FileWatcher::Matches(const std::filesystem::path& path) const
+	{
+		if (m_Extensions.empty())
+			return true;
+
+		std::string extension = path.extension().string();
+		return std::find(m_Extensions.begin(), m_Extensions.end(), extension) != m_Extensions.end();
+	}
+
+	void FileWatcher::Push(const std::filesystem::path& path)
+	{
+		if (!Matches(path))
+			return;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Changed.insert(path.string());
+	}
+
+	void FileWatcher::WatchNotify()
+	{
+#ifdef GEARHEAD_PLATFORM_UNIX
+		GEARHEAD_PROFILE_THREAD("File Watcher");
+
+		alignas(inotify_event) char buffer[4096];
+
+		while (!m_Stopping) {
+			// wake up now and then to notice Stop()
+			pollfd fd{ m_NotifyFd, POLLIN, 0 };
+			if (poll(&fd, 1, (int)POLL_INTERVAL.count()) <= 0)
+				continue;
+
+			ssize_t length;
+			while ((length = read(m_NotifyFd, buffer, sizeof(buffer))) > 0) {
+				for (char* ptr = buffer; ptr < buffer + length;) {
+					const inotify_event* event = (const inotify_event*)ptr;
+					if (event->len > 0) {
+						Push(m_Directory / event->name);
+					}
+					ptr += sizeof(inotify_event) + event->len;
+				}
+			}
+		}
+#endif
+	}
+
+	void FileWatcher::WatchPolling()
+	{
+		GEARHEAD_PROFILE_THREAD("File Watcher");
+
+		std::unordered_map<std::string, std::filesystem::file_time_type> lastWrite;
+
+		// first pass only records what's there
+		bool first = true;
+		while (!m_Stopping) {
+			std::error_code ec;
+			for (const auto& entry : std::filesystem::directory_iterator(m_Directory, ec)) {
+				if (!entry.is_regular_file(ec) || !Matches(entry.path()))
+					continue;
+
+				auto time = entry.last_write_time(ec);
+				auto [it, inserted] = lastWrite.try_emplace(entry.path().string(), time);
+				if (!inserted && it->second != time) {
+					it->second = time;
+					Push(entry.path());
+				}
+				else if (inserted && !first) {
+					Push(entry.path());
+				}
+			}
+			first = false;
+
+			std::this_thread::sleep_for(POLL_INTERVAL);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Core.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace GearHead {
+
+	// Watches one directory (not recursive) on a background thread. inotify on Linux, a timestamp scan
+	// everywhere else. Changes are collected until the owner picks them up, so it never calls back
+	// into anything on its own thread.
+	class GEARHEAD_API FileWatcher {
+	public:
+		static constexpr std::chrono::milliseconds POLL_INTERVAL{ 250 };
+
+		FileWatcher() = default;
+		~FileWatcher();
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		// extensions include the dot (".comp"), empty watches every file
+		bool Start(const std::string& directory, std::vector<std::string> extensions = {});
+		void Stop();
+		bool IsRunning() const { return m_Thread.joinable(); }
+
+		// every file written since the last call, once each
+		std::vector<std::string> PollChanges();
+
+	private:
+		bool Matches(const std::filesystem::path& path) const;
+		void Push(const std::filesystem::path& path);
+
+		void WatchNotify();
+		void WatchPolling();
+
+		std::filesystem::path m_Directory;
+		std::vector<std::string> m_Extensions;
+
+		std::thread m_Thread;
+		std::atomic<bool> m_Stopping{ false };
+		int m_NotifyFd = -1;
+
+		std::mutex m_Mutex;
+		std::set<std::string> m_Changed;
+	};
+}
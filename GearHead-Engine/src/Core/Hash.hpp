@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GearHead {
+
+	// FNV-1a 64, for content keys and corruption checks, not for anything adversarial
+	inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		uint64_t hash = seed;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+}
@@ -2,32 +2,104 @@
 
 #include "Log.hpp"
 
+#include <spdlog/async.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
+#include <atomic>
+
 namespace GearHead {
     std::shared_ptr<spdlog::logger> Log::s_CoreLogger;
     std::shared_ptr<spdlog::logger> Log::s_ClientLogger;
+    std::atomic<uint64_t> Log::s_Frame{ 0 };
+
+    namespace {
+        std::vector<spdlog::sink_ptr> s_Sinks;
+        LogSettings s_Settings;
+        std::atomic<bool> s_ShuttingDown{ false };
+        std::terminate_handler s_PreviousTerminate = nullptr;
+
+        std::shared_ptr<spdlog::logger> CreateLogger(const char* name, bool async)
+        {
+            std::shared_ptr<spdlog::logger> logger;
+            if (async) {
+                auto policy = s_Settings.Overflow == LogSettings::OverflowPolicy::Block
+                    ? spdlog::async_overflow_policy::block
+                    : spdlog::async_overflow_policy::overrun_oldest;
+                logger = std::make_shared<spdlog::async_logger>(name, begin(s_Sinks), end(s_Sinks), spdlog::thread_pool(), policy);
+            }
+            else {
+                logger = std::make_shared<spdlog::logger>(name, begin(s_Sinks), end(s_Sinks));
+            }
+
+            spdlog::register_logger(logger);
+            logger->set_level(spdlog::level::trace);
+            logger->flush_on(s_Settings.FlushLevel);
+            return logger;
+        }
+
+        void OnTerminate()
+        {
+            Log::Drain();
+            if (s_PreviousTerminate)
+                s_PreviousTerminate();
+            std::abort();
+        }
+    }
+
+    void Log::Init(const LogSettings& settings) {
+
+		s_Settings = settings;
+
+		s_Sinks.clear();
+		s_Sinks.emplace_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+		s_Sinks.emplace_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>("GearHead.log", true));
 
-    void Log::Init() {
+		s_Sinks[0]->set_pattern("%^[%T] %n: %v%$");
+		s_Sinks[1]->set_pattern("[%T] [%l] %n: %v");
 
-		std::vector<spdlog::sink_ptr> logSinks;
-		logSinks.emplace_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
-		logSinks.emplace_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>("GearHead.log", true));
+		if (settings.Async) {
+			// one worker keeps the lines in order across both loggers
+			spdlog::init_thread_pool(settings.QueueSize, 1);
+		}
+
+		s_CoreLogger = CreateLogger("GEARHEAD", settings.Async);
+		s_ClientLogger = CreateLogger("APP", settings.Async);
+
+		// batched flushing for everything below the flush level
+		spdlog::flush_every(settings.FlushInterval);
+
+		s_ShuttingDown = false;
+		std::atexit(Log::Shutdown);
+		s_PreviousTerminate = std::set_terminate(OnTerminate);
+    }
+
+    void Log::Drain() {
+
+		if (!s_CoreLogger || s_ShuttingDown.exchange(true))
+			return;
+
+		// other threads can still be logging, so the loggers stay as they are. Whatever they log after
+		// this is reported by spdlog's error handler instead of written
+		spdlog::shutdown();
+    }
 
-		logSinks[0]->set_pattern("%^[%T] %n: %v%$");
-		logSinks[1]->set_pattern("[%T] [%l] %n: %v");
+    void Log::Shutdown() {
 
-		s_CoreLogger = std::make_shared<spdlog::logger>("GEARHEAD", begin(logSinks), end(logSinks));
-		spdlog::register_logger(s_CoreLogger);
-		s_CoreLogger->set_level(spdlog::level::trace);
-		s_CoreLogger->flush_on(spdlog::level::trace);
+		if (!s_CoreLogger || s_ShuttingDown.exchange(true))
+			return;
 
-		s_ClientLogger = std::make_shared<spdlog::logger>("APP", begin(logSinks), end(logSinks));
-		spdlog::register_logger(s_ClientLogger);
-		s_ClientLogger->set_level(spdlog::level::trace);
-		s_ClientLogger->flush_on(spdlog::level::trace);
+		if (s_Settings.Async) {
+			// joins the worker once everything queued has been written
+			spdlog::shutdown();
 
+			// anything logged from here on (static destructors) goes straight to the sinks
+			s_Settings.Async = false;
+			s_CoreLogger = CreateLogger("GEARHEAD", false);
+			s_ClientLogger = CreateLogger("APP", false);
+		}
 
+		s_CoreLogger->flush();
+		s_ClientLogger->flush();
     }
 }
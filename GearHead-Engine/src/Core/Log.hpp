@@ -7,32 +7,172 @@
 #include <spdlog/fmt/ostr.h>
 #pragma warning(pop)
 
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+// Compile time minimum log level, calls below it expand to nothing and never evaluate their arguments.
+// Values match spdlog::level::level_enum. Override by defining GEARHEAD_LOG_LEVEL for the build.
+#define GEARHEAD_LOG_LEVEL_TRACE     0
+#define GEARHEAD_LOG_LEVEL_DEBUG     1
+#define GEARHEAD_LOG_LEVEL_INFO      2
+#define GEARHEAD_LOG_LEVEL_WARN      3
+#define GEARHEAD_LOG_LEVEL_ERROR     4
+#define GEARHEAD_LOG_LEVEL_CRITICAL  5
+#define GEARHEAD_LOG_LEVEL_OFF       6
+
+#ifndef GEARHEAD_LOG_LEVEL
+    #if defined(GEARHEAD_DIST)
+        #define GEARHEAD_LOG_LEVEL GEARHEAD_LOG_LEVEL_ERROR
+    #elif defined(GEARHEAD_RELEASE)
+        #define GEARHEAD_LOG_LEVEL GEARHEAD_LOG_LEVEL_WARN
+    #else
+        #define GEARHEAD_LOG_LEVEL GEARHEAD_LOG_LEVEL_TRACE
+    #endif
+#endif
+
 
 namespace GearHead{
+
+    // How the loggers get lines to the sinks. Async hands formatting and I/O to a background
+    // thread so the render loop only pays for a queue push.
+    struct LogSettings {
+        enum class OverflowPolicy {
+            Block,      // caller waits for room, nothing is lost
+            DropOldest  // oldest queued line is overwritten, caller never waits
+        };
+
+        bool Async{ true };
+        size_t QueueSize{ 8192 };
+        OverflowPolicy Overflow{ OverflowPolicy::DropOldest };
+
+        // lines at or above this level are flushed as soon as they are written
+        spdlog::level::level_enum FlushLevel{ spdlog::level::err };
+        // everything else is flushed in batches by the background flusher
+        std::chrono::seconds FlushInterval{ 2 };
+    };
+
     class GEARHEAD_API Log {
         public:
-            static void Init();
+            static void Init(const LogSettings& settings = LogSettings());
+            // drains the async queue and flushes every sink, safe to call more than once. Swaps the loggers for
+            // synchronous ones, so only call it once no other thread can log
+            static void Shutdown();
+            // drains the async queue and flushes every sink but leaves the loggers alone, for fatal paths
+            // where other threads may still be logging. The process is expected to end right after
+            static void Drain();
 
             inline static std::shared_ptr<spdlog::logger>& GetCoreLogger() { return s_CoreLogger; }
 		    inline static std::shared_ptr<spdlog::logger>& GetClientLogger() { return s_ClientLogger; }
 
+            // frame counter for the *_EVERY_N_FRAMES macros, advanced by the application loop
+            inline static void SetFrame(uint64_t frame) { s_Frame.store(frame, std::memory_order_relaxed); }
+            inline static uint64_t GetFrame() { return s_Frame.load(std::memory_order_relaxed); }
+
         private:
             static std::shared_ptr<spdlog::logger> s_CoreLogger;
             static std::shared_ptr<spdlog::logger> s_ClientLogger;
+            static std::atomic<uint64_t> s_Frame;
     };
 }
 
+// checks the runtime level before the arguments get evaluated or formatted
+#define GEARHEAD_LOG_CALL(loggerPtr, level, ...) do { \
+        spdlog::logger* ghLogger_ = (loggerPtr).get(); \
+        if (ghLogger_->should_log(level)) { ghLogger_->log(level, __VA_ARGS__); } \
+    } while (0)
+
+#define GEARHEAD_LOG_STRIPPED(...) do {} while (0)
+
 //Core log macros
-#define GEARHEAD_CORE_ERROR(...)     ::GearHead::Log::GetCoreLogger()->error(__VA_ARGS__)
-#define GEARHEAD_CORE_WARN(...)      ::GearHead::Log::GetCoreLogger()->warn(__VA_ARGS__)
-#define GEARHEAD_CORE_INFO(...)      ::GearHead::Log::GetCoreLogger()->info(__VA_ARGS__)
-#define GEARHEAD_CORE_CRITICAL(...)  ::GearHead::Log::GetCoreLogger()->critical(__VA_ARGS__)
-#define GEARHEAD_CORE_TRACE(...)     ::GearHead::Log::GetCoreLogger()->trace(__VA_ARGS__)
-
-
-//Client log macros
-#define GEARHEAD_ERROR(...)          ::GearHead::Log::GetClientLogger()->error(__VA_ARGS__)
-#define GEARHEAD_WARN(...)           ::GearHead::Log::GetClientLogger()->warn(__VA_ARGS__)
-#define GEARHEAD_INFO(...)	         ::GearHead::Log::GetClientLogger()->info(__VA_ARGS__)
-#define GEARHEAD_CRITICAL(...)       ::GearHead::Log::GetClientLogger()->critical(__VA_ARGS__)
-#define GEARHEAD_TRACE(...)          ::GearHead::Log::GetClientLogger()->trace(__VA_ARGS__)
+#if GEARHEAD_LOG_LEVEL <= GEARHEAD_LOG_LEVEL_TRACE
+    #define GEARHEAD_CORE_TRACE(...)     GEARHEAD_LOG_CALL(::GearHead::Log::GetCoreLogger(), spdlog::level::trace, __VA_ARGS__)
+    #define GEARHEAD_TRACE(...)          GEARHEAD_LOG_CALL(::GearHead::Log::GetClientLogger(), spdlog::level::trace, __VA_ARGS__)
+#else
+    #define GEARHEAD_CORE_TRACE(...)     GEARHEAD_LOG_STRIPPED()
+    #define GEARHEAD_TRACE(...)          GEARHEAD_LOG_STRIPPED()
+#endif
+
+#if GEARHEAD_LOG_LEVEL <= GEARHEAD_LOG_LEVEL_DEBUG
+    #define GEARHEAD_CORE_DEBUG(...)     GEARHEAD_LOG_CALL(::GearHead::Log::GetCoreLogger(), spdlog::level::debug, __VA_ARGS__)
+    #define GEARHEAD_DEBUG(...)          GEARHEAD_LOG_CALL(::GearHead::Log::GetClientLogger(), spdlog::level::debug, __VA_ARGS__)
+#else
+    #define GEARHEAD_CORE_DEBUG(...)     GEARHEAD_LOG_STRIPPED()
+    #define GEARHEAD_DEBUG(...)          GEARHEAD_LOG_STRIPPED()
+#endif
+
+#if GEARHEAD_LOG_LEVEL <= GEARHEAD_LOG_LEVEL_INFO
+    #define GEARHEAD_CORE_INFO(...)      GEARHEAD_LOG_CALL(::GearHead::Log::GetCoreLogger(), spdlog::level::info, __VA_ARGS__)
+    #define GEARHEAD_INFO(...)           GEARHEAD_LOG_CALL(::GearHead::Log::GetClientLogger(), spdlog::level::info, __VA_ARGS__)
+#else
+    #define GEARHEAD_CORE_INFO(...)      GEARHEAD_LOG_STRIPPED()
+    #define GEARHEAD_INFO(...)           GEARHEAD_LOG_STRIPPED()
+#endif
+
+#if GEARHEAD_LOG_LEVEL <= GEARHEAD_LOG_LEVEL_WARN
+    #define GEARHEAD_CORE_WARN(...)      GEARHEAD_LOG_CALL(::GearHead::Log::GetCoreLogger(), spdlog::level::warn, __VA_ARGS__)
+    #define GEARHEAD_WARN(...)           GEARHEAD_LOG_CALL(::GearHead::Log::GetClientLogger(), spdlog::level::warn, __VA_ARGS__)
+#else
+    #define GEARHEAD_CORE_WARN(...)      GEARHEAD_LOG_STRIPPED()
+    #define GEARHEAD_WARN(...)           GEARHEAD_LOG_STRIPPED()
+#endif
+
+#if GEARHEAD_LOG_LEVEL <= GEARHEAD_LOG_LEVEL_ERROR
+    #define GEARHEAD_CORE_ERROR(...)     GEARHEAD_LOG_CALL(::GearHead::Log::GetCoreLogger(), spdlog::level::err, __VA_ARGS__)
+    #define GEARHEAD_ERROR(...)          GEARHEAD_LOG_CALL(::GearHead::Log::GetClientLogger(), spdlog::level::err, __VA_ARGS__)
+#else
+    #define GEARHEAD_CORE_ERROR(...)     GEARHEAD_LOG_STRIPPED()
+    #define GEARHEAD_ERROR(...)          GEARHEAD_LOG_STRIPPED()
+#endif
+
+#if GEARHEAD_LOG_LEVEL <= GEARHEAD_LOG_LEVEL_CRITICAL
+    #define GEARHEAD_CORE_CRITICAL(...)  GEARHEAD_LOG_CALL(::GearHead::Log::GetCoreLogger(), spdlog::level::critical, __VA_ARGS__)
+    #define GEARHEAD_CRITICAL(...)       GEARHEAD_LOG_CALL(::GearHead::Log::GetClientLogger(), spdlog::level::critical, __VA_ARGS__)
+#else
+    #define GEARHEAD_CORE_CRITICAL(...)  GEARHEAD_LOG_STRIPPED()
+    #define GEARHEAD_CRITICAL(...)       GEARHEAD_LOG_STRIPPED()
+#endif
+
+
+// Hot path logging. level is the macro suffix (TRACE, DEBUG, INFO, WARN, ERROR, CRITICAL), so a stripped level
+// strips the bookkeeping with it, e.g. GEARHEAD_CORE_LOG_EVERY_N_FRAMES(INFO, 60, "draws: {0}", count)
+
+// first call only
+#define GEARHEAD_LOG_ONCE_IMPL(logMacro, ...) do { \
+        static std::atomic<bool> ghLogged_{ false }; \
+        if (!ghLogged_.exchange(true, std::memory_order_relaxed)) { logMacro(__VA_ARGS__); } \
+    } while (0)
+
+// every nth call
+#define GEARHEAD_LOG_EVERY_N_IMPL(logMacro, n, ...) do { \
+        static std::atomic<uint64_t> ghCount_{ 0 }; \
+        if (ghCount_.fetch_add(1, std::memory_order_relaxed) % (n) == 0) { logMacro(__VA_ARGS__); } \
+    } while (0)
+
+// at most once on frames that are a multiple of n, however often the line is hit per frame
+#define GEARHEAD_LOG_EVERY_N_FRAMES_IMPL(logMacro, n, ...) do { \
+        static std::atomic<uint64_t> ghLastFrame_{ ~0ull }; \
+        uint64_t ghFrame_ = ::GearHead::Log::GetFrame(); \
+        if (ghFrame_ % (n) == 0 && ghLastFrame_.exchange(ghFrame_, std::memory_order_relaxed) != ghFrame_) { logMacro(__VA_ARGS__); } \
+    } while (0)
+
+// at most once per intervalMs milliseconds
+#define GEARHEAD_LOG_RATE_LIMITED_IMPL(logMacro, intervalMs, ...) do { \
+        static std::atomic<int64_t> ghLastMs_{ std::numeric_limits<int64_t>::min() / 2 }; \
+        int64_t ghNowMs_ = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); \
+        int64_t ghPrevMs_ = ghLastMs_.load(std::memory_order_relaxed); \
+        if (ghNowMs_ - ghPrevMs_ >= (intervalMs) && ghLastMs_.compare_exchange_strong(ghPrevMs_, ghNowMs_, std::memory_order_relaxed)) { logMacro(__VA_ARGS__); } \
+    } while (0)
+
+// takes the numeric level, the name is pasted by the caller so a Windows ERROR macro can't expand it first
+#define GEARHEAD_LOG_IF_ENABLED(levelValue, impl) do { if constexpr ((levelValue) >= GEARHEAD_LOG_LEVEL) { impl; } } while (0)
+
+#define GEARHEAD_CORE_LOG_ONCE(level, ...)                      GEARHEAD_LOG_IF_ENABLED(GEARHEAD_LOG_LEVEL_##level, GEARHEAD_LOG_ONCE_IMPL(GEARHEAD_CORE_##level, __VA_ARGS__))
+#define GEARHEAD_CORE_LOG_EVERY_N(level, n, ...)                GEARHEAD_LOG_IF_ENABLED(GEARHEAD_LOG_LEVEL_##level, GEARHEAD_LOG_EVERY_N_IMPL(GEARHEAD_CORE_##level, n, __VA_ARGS__))
+#define GEARHEAD_CORE_LOG_EVERY_N_FRAMES(level, n, ...)         GEARHEAD_LOG_IF_ENABLED(GEARHEAD_LOG_LEVEL_##level, GEARHEAD_LOG_EVERY_N_FRAMES_IMPL(GEARHEAD_CORE_##level, n, __VA_ARGS__))
+#define GEARHEAD_CORE_LOG_RATE_LIMITED(level, intervalMs, ...)  GEARHEAD_LOG_IF_ENABLED(GEARHEAD_LOG_LEVEL_##level, GEARHEAD_LOG_RATE_LIMITED_IMPL(GEARHEAD_CORE_##level, intervalMs, __VA_ARGS__))
+
+#define GEARHEAD_LOG_ONCE(level, ...)                           GEARHEAD_LOG_IF_ENABLED(GEARHEAD_LOG_LEVEL_##level, GEARHEAD_LOG_ONCE_IMPL(GEARHEAD_##level, __VA_ARGS__))
+#define GEARHEAD_LOG_EVERY_N(level, n, ...)                     GEARHEAD_LOG_IF_ENABLED(GEARHEAD_LOG_LEVEL_##level, GEARHEAD_LOG_EVERY_N_IMPL(GEARHEAD_##level, n, __VA_ARGS__))
+#define GEARHEAD_LOG_EVERY_N_FRAMES(level, n, ...)              GEARHEAD_LOG_IF_ENABLED(GEARHEAD_LOG_LEVEL_##level, GEARHEAD_LOG_EVERY_N_FRAMES_IMPL(GEARHEAD_##level, n, __VA_ARGS__))
+#define GEARHEAD_LOG_RATE_LIMITED(level, intervalMs, ...)       GEARHEAD_LOG_IF_ENABLED(GEARHEAD_LOG_LEVEL_##level, GEARHEAD_LOG_RATE_LIMITED_IMPL(GEARHEAD_##level, intervalMs, __VA_ARGS__))
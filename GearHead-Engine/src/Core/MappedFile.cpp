@@ -0,0 +1,139 @@
+#include "ghpch.hpp"
+
+#include "MappedFile.hpp"
+
+#ifdef GEARHEAD_PLATFORM_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace GearHead {
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other) {
+			Close();
+			std::swap(m_Data, other.m_Data);
+			std::swap(m_Size, other.m_Size);
+#ifdef GEARHEAD_PLATFORM_WINDOWS
+			std::swap(m_File, other.m_File);
+			std::swap(m_Mapping, other.m_Mapping);
+#endif
+		}
+		return *this;
+	}
+
+#ifdef GEARHEAD_PLATFORM_UNIX
+
+	bool MappedFile::Open(const std::string& path)
+	{
+		Close();
+
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			close(fd);
+			return false;
+		}
+
+		void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		//the mapping keeps its own reference to the file
+		close(fd);
+
+		if (data == MAP_FAILED)
+			return false;
+
+		m_Data = (const uint8_t*)data;
+		m_Size = (size_t)info.st_size;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data) {
+			munmap((void*)m_Data, m_Size);
+			m_Data = nullptr;
+			m_Size = 0;
+		}
+	}
+
+	void MappedFile::Prefetch() const
+	{
+		if (m_Data)
+			madvise((void*)m_Data, m_Size, MADV_WILLNEED);
+	}
+
+#elif defined(GEARHEAD_PLATFORM_WINDOWS)
+
+	bool MappedFile::Open(const std::string& path)
+	{
+		Close();
+
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) {
+			CloseHandle(file);
+			return false;
+		}
+
+		void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!data) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		m_File = file;
+		m_Mapping = mapping;
+		m_Data = (const uint8_t*)data;
+		m_Size = (size_t)size.QuadPart;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_Data) {
+			UnmapViewOfFile(m_Data);
+			CloseHandle(m_Mapping);
+			CloseHandle(m_File);
+			m_Data = nullptr;
+			m_Size = 0;
+			m_File = nullptr;
+			m_Mapping = nullptr;
+		}
+	}
+
+	void MappedFile::Prefetch() const
+	{
+		if (m_Data) {
+			WIN32_MEMORY_RANGE_ENTRY range{ (void*)m_Data, m_Size };
+			PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+		}
+	}
+
+#endif
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Core.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace GearHead {
+
+	// Read only view of a whole file mapped into memory. Pages are faulted in on first touch,
+	// so opening is cheap regardless of the file size.
+	class GEARHEAD_API MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool Open(const std::string& path);
+		void Close();
+
+		// ask the OS to start reading the whole file in ahead of use
+		void Prefetch() const;
+
+		bool IsOpen() const { return m_Data != nullptr; }
+		const uint8_t* Data() const { return m_Data; }
+		size_t Size() const { return m_Size; }
+		std::span<const uint8_t> Bytes() const { return { m_Data, m_Size }; }
+
+	private:
+		const uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+
+#ifdef GEARHEAD_PLATFORM_WINDOWS
+		void* m_File = nullptr;
+		void* m_Mapping = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,131 @@
+#include "ghpch.hpp"
+
+#include "Profiler.hpp"
+
+#include <mutex>
+
+namespace GearHead {
+
+	namespace {
+		// Single producer ring, only the owning thread writes. Readers take a snapshot and drop
+		// whatever the writer lapped while they were copying.
+		struct ThreadRing {
+			std::string name;
+			uint32_t tid{ 0 };
+			std::atomic<uint64_t> head{ 0 };
+			std::vector<ProfileZone> zones;
+		};
+
+		const std::chrono::steady_clock::time_point s_Epoch = std::chrono::steady_clock::now();
+
+		//rings are never freed before exit, so a trace can still include threads that already finished
+		std::mutex s_RingsMutex;
+		std::vector<std::unique_ptr<ThreadRing>> s_Rings;
+
+		thread_local ThreadRing* t_Ring = nullptr;
+
+		ThreadRing& GetThreadRing()
+		{
+			if (t_Ring == nullptr) {
+				auto ring = std::make_unique<ThreadRing>();
+				ring->zones.resize(Profiler::RING_SIZE);
+
+				std::lock_guard<std::mutex> lock(s_RingsMutex);
+				ring->tid = (uint32_t)s_Rings.size();
+				ring->name = "Thread " + std::to_string(ring->tid);
+				t_Ring = ring.get();
+				s_Rings.push_back(std::move(ring));
+			}
+			return *t_Ring;
+		}
+
+		void WriteJsonString(std::ostream& out, const char* str)
+		{
+			out << '"';
+			for (; *str; str++) {
+				if (*str == '"' || *str == '\\')
+					out << '\\';
+				out << *str;
+			}
+			out << '"';
+		}
+	}
+
+	void Profiler::Init()
+	{
+		SetThreadName("Main");
+	}
+
+	int64_t Profiler::NowUs()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_Epoch).count();
+	}
+
+	void Profiler::SetThreadName(const char* name)
+	{
+		ThreadRing& ring = GetThreadRing();
+		std::lock_guard<std::mutex> lock(s_RingsMutex);
+		ring.name = name;
+	}
+
+	void Profiler::Record(const char* name, int64_t beginUs, int64_t endUs)
+	{
+		ThreadRing& ring = GetThreadRing();
+		uint64_t head = ring.head.load(std::memory_order_relaxed);
+		ring.zones[head & (RING_SIZE - 1)] = { name, beginUs, endUs };
+		ring.head.store(head + 1, std::memory_order_release);
+	}
+
+	bool Profiler::WriteChromeTrace(const std::string& path, const std::function<void(std::ostream&)>& appendEvents)
+	{
+		std::ofstream file(path);
+		if (!file.is_open()) {
+			GEARHEAD_CORE_ERROR("Failed to open {0} for the CPU trace", path);
+			return false;
+		}
+
+		size_t zoneCount = 0;
+		std::vector<ProfileZone> snapshot;
+
+		// chrome://tracing / Perfetto "complete" events, times in microseconds
+		file << "{\"traceEvents\":[\n";
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}}";
+
+		std::lock_guard<std::mutex> lock(s_RingsMutex);
+		for (const std::unique_ptr<ThreadRing>& ring : s_Rings) {
+			file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->tid << ",\"args\":{\"name\":";
+			WriteJsonString(file, ring->name.c_str());
+			file << "}}";
+
+			uint64_t head = ring->head.load(std::memory_order_acquire);
+			uint64_t first = head > RING_SIZE ? head - RING_SIZE : 0;
+
+			snapshot.clear();
+			for (uint64_t i = first; i < head; i++) {
+				snapshot.push_back(ring->zones[i & (RING_SIZE - 1)]);
+			}
+
+			//anything the writer reached again during the copy may be torn
+			uint64_t headAfter = ring->head.load(std::memory_order_acquire);
+			uint64_t valid = headAfter > RING_SIZE ? headAfter - RING_SIZE : 0;
+			size_t skip = valid > first ? (size_t)std::min<uint64_t>(valid - first, snapshot.size()) : 0;
+
+			for (size_t i = skip; i < snapshot.size(); i++) {
+				const ProfileZone& zone = snapshot[i];
+				file << ",\n{\"name\":";
+				WriteJsonString(file, zone.name);
+				file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid
+					<< ",\"ts\":" << zone.beginUs << ",\"dur\":" << (zone.endUs - zone.beginUs) << "}";
+			}
+			zoneCount += snapshot.size() - skip;
+		}
+
+		if (appendEvents)
+			appendEvents(file);
+
+		file << "\n]}\n";
+
+		GEARHEAD_CORE_INFO("Wrote {0} CPU zones to {1}", zoneCount, path);
+		return true;
+	}
+}
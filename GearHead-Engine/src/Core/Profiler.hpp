@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Core.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+// CPU scoped-zone profiler. Every thread records into its own ring buffer without locking,
+// the trace writer reads the rings from any thread. Compiles out entirely in dist builds.
+#ifndef GEARHEAD_DIST
+	#define GEARHEAD_PROFILE 1
+#endif
+
+namespace GearHead {
+
+	struct ProfileZone {
+		const char* name;
+		//microseconds since Profiler::Init, same clock as Profiler::NowUs
+		int64_t beginUs;
+		int64_t endUs;
+	};
+
+	class GEARHEAD_API Profiler {
+	public:
+		//power of two, about 1.5MB per thread
+		static constexpr uint32_t RING_SIZE = 1u << 16;
+
+		static void Init();
+		static int64_t NowUs();
+
+		static void SetThreadName(const char* name);
+		static void Record(const char* name, int64_t beginUs, int64_t endUs);
+
+		//appendEvents lets other timelines (the GPU) add their own events, each written as ",\n{...}"
+		static bool WriteChromeTrace(const std::string& path, const std::function<void(std::ostream&)>& appendEvents = {});
+	};
+
+	class ProfileScope {
+	public:
+		explicit ProfileScope(const char* name) : _name(name), _beginUs(Profiler::NowUs()) {}
+		~ProfileScope() { Profiler::Record(_name, _beginUs, Profiler::NowUs()); }
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+		const char* _name;
+		int64_t _beginUs;
+	};
+}
+
+#ifdef GEARHEAD_PROFILE
+	#define GEARHEAD_PROFILE_CONCAT_INNER(a, b) a##b
+	#define GEARHEAD_PROFILE_CONCAT(a, b) GEARHEAD_PROFILE_CONCAT_INNER(a, b)
+
+	//name must outlive the trace dump, string literals only
+	#define GEARHEAD_PROFILE_SCOPE(name) ::GearHead::ProfileScope GEARHEAD_PROFILE_CONCAT(profileScope, __LINE__)(name)
+	#define GEARHEAD_PROFILE_FUNCTION() GEARHEAD_PROFILE_SCOPE(__FUNCTION__)
+	#define GEARHEAD_PROFILE_THREAD(name) ::GearHead::Profiler::SetThreadName(name)
+#else
+	#define GEARHEAD_PROFILE_SCOPE(name)
+	#define GEARHEAD_PROFILE_FUNCTION()
+	#define GEARHEAD_PROFILE_THREAD(name)
+#endif
@@ -0,0 +1,76 @@
+#include "ghpch.hpp"
+
+#include "ThreadPool.hpp"
+#include "Profiler.hpp"
+
+namespace GearHead {
+
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		if (threadCount == 0) {
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		m_Workers.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; i++) {
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+		}
+
+		GEARHEAD_CORE_INFO("Thread pool started with {0} workers", threadCount);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		Shutdown();
+	}
+
+	void ThreadPool::Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stopping = true;
+		}
+		m_Wake.notify_all();
+
+		// queued tasks still run, nobody is left holding a future that never resolves
+		for (std::thread& worker : m_Workers) {
+			if (worker.joinable())
+				worker.join();
+		}
+	}
+
+	ThreadPool& ThreadPool::Get()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+	size_t ThreadPool::GetQueuedTasks() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Tasks.size();
+	}
+
+	void ThreadPool::WorkerLoop(uint32_t index)
+	{
+		std::string name = "Worker " + std::to_string(index);
+		GEARHEAD_PROFILE_THREAD(name.c_str());
+
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Wake.wait(lock, [this]() { return m_Stopping || !m_Tasks.empty(); });
+
+				if (m_Tasks.empty())
+					return;
+
+				task = std::move(m_Tasks.front());
+				m_Tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+}
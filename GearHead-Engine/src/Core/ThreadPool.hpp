@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Core.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace GearHead {
+
+	// Fixed set of worker threads pulling from one FIFO queue. Tasks must not block on other tasks
+	// from the same pool, every worker could end up waiting.
+	class GEARHEAD_API ThreadPool {
+	public:
+		// 0 picks one worker per hardware thread, minus one for the main thread
+		explicit ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		// shared engine pool, created on first use
+		static ThreadPool& Get();
+
+		// runs what is still queued and joins the workers, safe to call more than once. Anything submitted
+		// afterwards runs on the calling thread
+		void Shutdown();
+
+		template<typename F>
+		auto Submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+		{
+			using Result = std::invoke_result_t<std::decay_t<F>>;
+
+			// std::function needs a copyable callable, packaged_task is move only
+			auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+			std::future<Result> future = packaged->get_future();
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (!m_Stopping) {
+					m_Tasks.emplace_back([packaged]() { (*packaged)(); });
+					packaged = nullptr;
+				}
+			}
+
+			if (packaged) {
+				(*packaged)();
+				return future;
+			}
+			m_Wake.notify_one();
+
+			return future;
+		}
+
+		uint32_t GetThreadCount() const { return (uint32_t)m_Workers.size(); }
+		size_t GetQueuedTasks() const;
+
+	private:
+		void WorkerLoop(uint32_t index);
+
+		std::vector<std::thread> m_Workers;
+		std::deque<std::function<void()>> m_Tasks;
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Wake;
+		bool m_Stopping = false;
+	};
+
+	// non-blocking check for the render thread
+	template<typename T>
+	bool IsReady(const std::future<T>& future)
+	{
+		return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+}
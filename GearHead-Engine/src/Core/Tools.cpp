@@ -0,0 +1,18 @@
+#include "ghpch.hpp"
+
+#include "Tools.hpp"
+#include "Game/Assets/MeshCache.hpp"
+
+namespace GearHead {
+
+	bool RunTool(int argc, char** argv, int& exitCode)
+	{
+		if (argc >= 3 && std::string(argv[1]) == "--cook-mesh") {
+			std::string cachePath = argc >= 4 ? argv[3] : MeshCache::GetCachePath(argv[2]);
+			exitCode = MeshCache::Cook(argv[2], cachePath) ? EXIT_SUCCESS : EXIT_FAILURE;
+			return true;
+		}
+
+		return false;
+	}
+}
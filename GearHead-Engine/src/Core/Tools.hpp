@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Core.hpp"
+
+namespace GearHead {
+
+	// Command line tools that run instead of the application, no window is created.
+	//   --cook-mesh <source.obj> [out.ghmesh]
+	// Returns false when argv names no tool, otherwise exitCode holds the tool's result
+	GEARHEAD_API bool RunTool(int argc, char** argv, int& exitCode);
+}
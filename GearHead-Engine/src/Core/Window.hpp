@@ -15,6 +15,14 @@ namespace GearHead {
 		unsigned int Width;
 		unsigned int Height;
 
+		// Offscreen rendering with no surface or swapchain (CI, render farm)
+		bool Headless{ false };
+		// Frames to render before a headless window reports it should close. 0 runs forever
+		unsigned int HeadlessFrames{ 0 };
+
+		// How many frames the cpu may record ahead of the gpu (1 - 4). Lower is less latency, higher is more throughput
+		unsigned int FramesInFlight{ 2 };
+
 		WindowProps(const std::string& title = "GearHead Engine", unsigned int width = 1280, unsigned int height = 720) 
 		: Title(title), Width(width), Height(height) {}
 	};
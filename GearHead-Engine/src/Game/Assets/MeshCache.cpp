@@ -0,0 +1,312 @@
+#include "MeshCache.hpp"
+#include "Core/Profiler.hpp"
+
+#include <filesystem>
+
+namespace GearHead {
+
+	namespace {
+		constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+		uint64_t AlignSection(uint64_t offset)
+		{
+			return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+		}
+
+		bool InFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+		{
+			return offset <= fileSize && size <= fileSize - offset;
+		}
+
+		void WritePadding(std::ofstream& file, uint64_t& position, uint64_t target)
+		{
+			static const char zeros[SECTION_ALIGNMENT] = {};
+			file.write(zeros, std::streamsize(target - position));
+			position = target;
+		}
+	}
+
+	bool MeshCacheFile::Open(const std::string& path, std::string& error)
+	{
+		if (!m_File.Open(path)) {
+			error = "could not map file";
+			return false;
+		}
+
+		uint64_t fileSize = m_File.Size();
+		if (fileSize < sizeof(MeshCacheHeader)) {
+			error = "truncated header";
+			return false;
+		}
+
+		m_Header = (const MeshCacheHeader*)m_File.Data();
+		if (m_Header->magic != MESH_CACHE_MAGIC) {
+			error = "not a mesh cache";
+			return false;
+		}
+		if (m_Header->version != MESH_CACHE_VERSION) {
+			error = fmt::format("version {0}, expected {1}", m_Header->version, MESH_CACHE_VERSION);
+			return false;
+		}
+		VertexFormatInfo format = Vertex::get_format_info(GEOMETRY_VERTEX_FORMAT);
+		if (m_Header->vertexFormat != (uint32_t)GEOMETRY_VERTEX_FORMAT
+			|| memcmp(m_Header->streamStrides, format.strides, sizeof(format.strides)) != 0) {
+			error = "vertex layout doesn't match this build";
+			return false;
+		}
+		m_StreamCount = format.streamCount;
+		if (m_Header->fileSize != fileSize) {
+			error = "size mismatch, file was cut short";
+			return false;
+		}
+		if (!InFile(sizeof(MeshCacheHeader), uint64_t(m_Header->meshCount) * sizeof(MeshCacheEntry), fileSize)) {
+			error = "mesh table out of bounds";
+			return false;
+		}
+
+		m_Entries = (const MeshCacheEntry*)(m_File.Data() + sizeof(MeshCacheHeader));
+
+		//everything gets checked once here so the getters can trust the offsets
+		for (uint32_t i = 0; i < m_Header->meshCount; i++) {
+			const MeshCacheEntry& entry = m_Entries[i];
+			//the importer never writes these, nothing could upload them
+			if (entry.vertexCount == 0 || entry.indexCount == 0) {
+				error = fmt::format("mesh {0} is empty", i);
+				return false;
+			}
+
+			bool valid = entry.indexOffset % SECTION_ALIGNMENT == 0
+				&& InFile(entry.indexOffset, uint64_t(entry.indexCount) * sizeof(uint32_t), fileSize);
+			for (uint32_t stream = 0; stream < m_StreamCount; stream++) {
+				valid = valid && entry.vertexOffsets[stream] % SECTION_ALIGNMENT == 0
+					&& InFile(entry.vertexOffsets[stream], uint64_t(entry.vertexCount) * m_Header->streamStrides[stream], fileSize);
+			}
+			valid = valid && entry.meshletOffset % SECTION_ALIGNMENT == 0
+				&& InFile(entry.meshletOffset, uint64_t(entry.meshletCount) * sizeof(Meshlet), fileSize);
+			if (!valid) {
+				error = fmt::format("mesh {0} out of bounds", i);
+				return false;
+			}
+
+			//meshlets get drawn as index ranges of their own, one outside the mesh would read another mesh's indices
+			for (const Meshlet& meshlet : GetMeshletData(i)) {
+				if (meshlet.indexCount % 3 != 0 || meshlet.firstIndex > entry.indexCount || meshlet.indexCount > entry.indexCount - meshlet.firstIndex) {
+					error = fmt::format("mesh {0} has a meshlet out of bounds", i);
+					return false;
+				}
+			}
+		}
+
+		//the upload memcpy will touch all of it soon
+		m_File.Prefetch();
+		return true;
+	}
+
+	MeshBounds MeshCacheFile::GetBounds(uint32_t mesh) const
+	{
+		const MeshCacheEntry& entry = m_Entries[mesh];
+
+		MeshBounds bounds;
+		bounds.min = { entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2] };
+		bounds.max = { entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2] };
+		bounds.sphereCenter = { entry.sphere[0], entry.sphere[1], entry.sphere[2] };
+		bounds.sphereRadius = entry.sphere[3];
+		return bounds;
+	}
+
+	std::span<const uint8_t> MeshCacheFile::GetVertexData(uint32_t mesh, uint32_t stream) const
+	{
+		const MeshCacheEntry& entry = m_Entries[mesh];
+		return { m_File.Data() + entry.vertexOffsets[stream], size_t(entry.vertexCount) * m_Header->streamStrides[stream] };
+	}
+
+	std::span<const uint32_t> MeshCacheFile::GetIndexData(uint32_t mesh) const
+	{
+		const MeshCacheEntry& entry = m_Entries[mesh];
+		return { (const uint32_t*)(m_File.Data() + entry.indexOffset), entry.indexCount };
+	}
+
+	std::span<const Meshlet> MeshCacheFile::GetMeshletData(uint32_t mesh) const
+	{
+		const MeshCacheEntry& entry = m_Entries[mesh];
+		return { (const Meshlet*)(m_File.Data() + entry.meshletOffset), entry.meshletCount };
+	}
+
+	std::string MeshCache::GetCachePath(const std::string& sourcePath)
+	{
+		return std::filesystem::path(sourcePath).replace_extension(MESH_CACHE_EXTENSION).string();
+	}
+
+	bool MeshCache::Write(const std::string& path, std::span<const ImportedMesh> meshes)
+	{
+		GEARHEAD_PROFILE_FUNCTION();
+
+		VertexFormatInfo format = Vertex::get_format_info(GEOMETRY_VERTEX_FORMAT);
+
+		MeshCacheHeader header{};
+		header.magic = MESH_CACHE_MAGIC;
+		header.version = MESH_CACHE_VERSION;
+		header.vertexFormat = (uint32_t)GEOMETRY_VERTEX_FORMAT;
+		header.meshCount = (uint32_t)meshes.size();
+		memcpy(header.streamStrides, format.strides, sizeof(format.strides));
+
+		//lay the streams out first so the table can be written in one go
+		std::vector<MeshCacheEntry> entries(meshes.size());
+		uint64_t offset = AlignSection(sizeof(MeshCacheHeader) + entries.size() * sizeof(MeshCacheEntry));
+		for (size_t i = 0; i < meshes.size(); i++) {
+			const Mesh& mesh = meshes[i].mesh;
+			MeshCacheEntry& entry = entries[i];
+
+			strncpy(entry.name, meshes[i].name.c_str(), sizeof(entry.name) - 1);
+			entry.vertexCount = (uint32_t)mesh._vertices.size();
+			entry.indexCount = (uint32_t)mesh._indices.size();
+			entry.meshletCount = (uint32_t)mesh._meshlets.size();
+
+			for (uint32_t stream = 0; stream < format.streamCount; stream++) {
+				entry.vertexOffsets[stream] = offset;
+				offset = AlignSection(offset + mesh._vertices.size() * format.strides[stream]);
+			}
+			entry.indexOffset = offset;
+			offset = AlignSection(offset + mesh._indices.size() * sizeof(uint32_t));
+			entry.meshletOffset = offset;
+			offset = AlignSection(offset + mesh._meshlets.size() * sizeof(Meshlet));
+
+			const MeshBounds& bounds = mesh._bounds;
+			memcpy(entry.boundsMin, &bounds.min, sizeof(entry.boundsMin));
+			memcpy(entry.boundsMax, &bounds.max, sizeof(entry.boundsMax));
+			memcpy(entry.sphere, &bounds.sphereCenter, sizeof(float) * 3);
+			entry.sphere[3] = bounds.sphereRadius;
+		}
+		header.fileSize = offset;
+
+		//written next to the target and renamed over it, a crash never leaves a half written cache behind
+		std::string tempPath = path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				GEARHEAD_CORE_ERROR("Failed to open {0} for writing", tempPath);
+				return false;
+			}
+
+			uint64_t position = 0;
+			std::vector<uint8_t> encoded[MAX_VERTEX_STREAMS];
+			file.write((const char*)&header, sizeof(header));
+			file.write((const char*)entries.data(), std::streamsize(entries.size() * sizeof(MeshCacheEntry)));
+			position = sizeof(header) + entries.size() * sizeof(MeshCacheEntry);
+
+			for (size_t i = 0; i < meshes.size(); i++) {
+				const Mesh& mesh = meshes[i].mesh;
+				const MeshCacheEntry& entry = entries[i];
+
+				//quantized here once instead of on every load
+				uint8_t* streams[MAX_VERTEX_STREAMS]{};
+				for (uint32_t stream = 0; stream < format.streamCount; stream++) {
+					encoded[stream].resize(mesh._vertices.size() * format.strides[stream]);
+					streams[stream] = encoded[stream].data();
+				}
+				Vertex::encode(GEOMETRY_VERTEX_FORMAT, mesh._vertices, streams);
+
+				for (uint32_t stream = 0; stream < format.streamCount; stream++) {
+					WritePadding(file, position, entry.vertexOffsets[stream]);
+					file.write((const char*)encoded[stream].data(), std::streamsize(encoded[stream].size()));
+					position += encoded[stream].size();
+				}
+
+				WritePadding(file, position, entry.indexOffset);
+				file.write((const char*)mesh._indices.data(), std::streamsize(mesh._indices.size() * sizeof(uint32_t)));
+				position += mesh._indices.size() * sizeof(uint32_t);
+
+				//built at import, the indices above are already in meshlet order
+				WritePadding(file, position, entry.meshletOffset);
+				file.write((const char*)mesh._meshlets.data(), std::streamsize(mesh._meshlets.size() * sizeof(Meshlet)));
+				position += mesh._meshlets.size() * sizeof(Meshlet);
+			}
+			WritePadding(file, position, header.fileSize);
+
+			if (!file.good()) {
+				GEARHEAD_CORE_ERROR("Failed writing {0}", tempPath);
+				return false;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, path, ec);
+		if (ec) {
+			GEARHEAD_CORE_ERROR("Failed to move {0} into place: {1}", tempPath, ec.message());
+			std::filesystem::remove(tempPath, ec);
+			return false;
+		}
+
+		GEARHEAD_CORE_INFO("Wrote mesh cache {0} ({1} meshes, {2} bytes)", path, meshes.size(), header.fileSize);
+		return true;
+	}
+
+	bool MeshCache::Cook(const std::string& sourcePath, const std::string& cachePath)
+	{
+		MeshImportResult result = ObjImporter::Load(sourcePath);
+		if (!result.success)
+			return false;
+
+		return Write(cachePath, result.meshes);
+	}
+
+	MeshImportResult MeshCache::Load(const std::string& path)
+	{
+		GEARHEAD_PROFILE_FUNCTION();
+
+		bool isCache = std::filesystem::path(path).extension() == MESH_CACHE_EXTENSION;
+		std::string cachePath = isCache ? path : GetCachePath(path);
+
+		std::error_code ec;
+		bool useCache = isCache;
+		if (!isCache && std::filesystem::exists(cachePath, ec)) {
+			auto sourceTime = std::filesystem::last_write_time(path, ec);
+			useCache = ec || std::filesystem::last_write_time(cachePath, ec) >= sourceTime;
+		}
+
+		if (useCache) {
+			auto start = std::chrono::high_resolution_clock::now();
+
+			auto cache = std::make_shared<MeshCacheFile>();
+			std::string error;
+			if (cache->Open(cachePath, error)) {
+				MeshImportResult result;
+				result.path = path;
+				result.success = true;
+				result.cache = cache;
+
+				for (uint32_t i = 0; i < cache->GetMeshCount(); i++) {
+					const MeshCacheEntry& entry = cache->GetEntry(i);
+
+					ImportedMesh& imported = result.meshes.emplace_back();
+					imported.name.assign(entry.name, strnlen(entry.name, sizeof(entry.name)));
+					imported.mesh._bounds = cache->GetBounds(i);
+					imported.cacheIndex = i;
+				}
+
+				auto end = std::chrono::high_resolution_clock::now();
+				GEARHEAD_CORE_INFO("Mapped {0}: {1} meshes in {2:.3f} ms", cachePath, result.meshes.size(),
+					std::chrono::duration<float, std::milli>(end - start).count());
+				return result;
+			}
+
+			if (isCache) {
+				GEARHEAD_CORE_ERROR("Failed to load {0}: {1}", cachePath, error);
+				return MeshImportResult{ path, false, error };
+			}
+
+			GEARHEAD_CORE_WARN("Ignoring mesh cache {0}: {1}, re-cooking", cachePath, error);
+		}
+
+		MeshImportResult result = ObjImporter::Load(path);
+		if (result.success) {
+			Write(cachePath, result.meshes);
+		}
+		return result;
+	}
+
+	std::future<MeshImportResult> MeshCache::LoadAsync(const std::string& path, ThreadPool& pool)
+	{
+		return pool.Submit([path]() { return Load(path); });
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "ghpch.hpp"
+#include "Core/MappedFile.hpp"
+#include "Game/Assets/ObjImporter.hpp"
+
+namespace GearHead {
+
+	// .ghmesh layout, little endian, every section 16 byte aligned:
+	//   MeshCacheHeader
+	//   MeshCacheEntry[meshCount]
+	//   per mesh: one vertex stream per stream of the vertex format, uint32 index stream, meshlets
+	// Bump MESH_CACHE_VERSION on any change, stale caches get re-cooked from their source.
+	constexpr uint32_t MESH_CACHE_MAGIC = 0x434D4847; // "GHMC"
+	constexpr uint32_t MESH_CACHE_VERSION = 3;
+	constexpr const char* MESH_CACHE_EXTENSION = ".ghmesh";
+
+	struct MeshCacheHeader {
+		uint32_t magic;
+		uint32_t version;
+		//VertexFormat the streams were encoded in, checked against GEOMETRY_VERTEX_FORMAT on load
+		uint32_t vertexFormat;
+		uint32_t meshCount;
+		uint32_t streamStrides[MAX_VERTEX_STREAMS];
+		uint64_t fileSize;
+	};
+
+	struct MeshCacheEntry {
+		char name[64];
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t meshletCount;
+		uint32_t reserved;
+		uint64_t vertexOffsets[MAX_VERTEX_STREAMS];
+		uint64_t indexOffset;
+		uint64_t meshletOffset;
+		float boundsMin[3];
+		float boundsMax[3];
+		float sphere[4];
+	};
+
+	static_assert(sizeof(MeshCacheHeader) == 32);
+	static_assert(sizeof(MeshCacheEntry) == 152);
+
+	// A mapped .ghmesh, streams are read straight out of the mapping
+	class GEARHEAD_API MeshCacheFile {
+	public:
+		bool Open(const std::string& path, std::string& error);
+
+		uint32_t GetMeshCount() const { return m_Header->meshCount; }
+		const MeshCacheEntry& GetEntry(uint32_t mesh) const { return m_Entries[mesh]; }
+		MeshBounds GetBounds(uint32_t mesh) const;
+
+		uint32_t GetStreamCount() const { return m_StreamCount; }
+		std::span<const uint8_t> GetVertexData(uint32_t mesh, uint32_t stream) const;
+		std::span<const uint32_t> GetIndexData(uint32_t mesh) const;
+		//empty for meshes too small to be split
+		std::span<const Meshlet> GetMeshletData(uint32_t mesh) const;
+
+	private:
+		MappedFile m_File;
+		const MeshCacheHeader* m_Header = nullptr;
+		const MeshCacheEntry* m_Entries = nullptr;
+		uint32_t m_StreamCount = 0;
+	};
+
+	class GEARHEAD_API MeshCache {
+	public:
+		// foo/bar.obj -> foo/bar.ghmesh
+		static std::string GetCachePath(const std::string& sourcePath);
+
+		static bool Write(const std::string& path, std::span<const ImportedMesh> meshes);
+
+		// offline cook, parses the source and writes its cache
+		static bool Cook(const std::string& sourcePath, const std::string& cachePath);
+
+		// .ghmesh paths map directly. Anything else uses its cache when it is at least as new as the
+		// source, otherwise the source gets imported and the cache written for next time
+		static MeshImportResult Load(const std::string& path);
+		static std::future<MeshImportResult> LoadAsync(const std::string& path, ThreadPool& pool = ThreadPool::Get());
+	};
+}
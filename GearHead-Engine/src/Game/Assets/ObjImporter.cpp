@@ -0,0 +1,163 @@
+#include "ObjImporter.hpp"
+#include "Core/Profiler.hpp"
+
+#include <tiny_obj_loader.h>
+#include <glm/glm.hpp>
+
+#include <filesystem>
+
+namespace GearHead {
+
+	namespace {
+		// an OBJ corner references position, normal and uv separately, equal triples are the same vertex
+		struct CornerKey {
+			int vertex;
+			int normal;
+			int texcoord;
+
+			bool operator==(const CornerKey& other) const {
+				return vertex == other.vertex && normal == other.normal && texcoord == other.texcoord;
+			}
+		};
+
+		struct CornerKeyHash {
+			size_t operator()(const CornerKey& key) const {
+				size_t hash = std::hash<int>()(key.vertex);
+				hash ^= std::hash<int>()(key.normal) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				hash ^= std::hash<int>()(key.texcoord) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				return hash;
+			}
+		};
+
+		void BuildMesh(const tinyobj::attrib_t& attrib, const tinyobj::shape_t& shape, Mesh& mesh)
+		{
+			const std::vector<tinyobj::index_t>& corners = shape.mesh.indices;
+
+			std::unordered_map<CornerKey, uint32_t, CornerKeyHash> unique;
+			unique.reserve(corners.size());
+			mesh._indices.reserve(corners.size());
+
+			//vertices without a normal in the file get the sum of their faces' normals
+			std::vector<bool> needsNormal;
+
+			for (const tinyobj::index_t& corner : corners) {
+				CornerKey key{ corner.vertex_index, corner.normal_index, corner.texcoord_index };
+
+				auto [it, inserted] = unique.try_emplace(key, (uint32_t)mesh._vertices.size());
+				if (inserted) {
+					Vertex vertex{};
+					vertex.position = {
+						attrib.vertices[3 * corner.vertex_index + 0],
+						attrib.vertices[3 * corner.vertex_index + 1],
+						attrib.vertices[3 * corner.vertex_index + 2] };
+
+					if (corner.normal_index >= 0) {
+						vertex.normal = {
+							attrib.normals[3 * corner.normal_index + 0],
+							attrib.normals[3 * corner.normal_index + 1],
+							attrib.normals[3 * corner.normal_index + 2] };
+					}
+
+					//tinyobj fills in white when the file has no vertex colors
+					if (!attrib.colors.empty()) {
+						vertex.color = {
+							attrib.colors[3 * corner.vertex_index + 0],
+							attrib.colors[3 * corner.vertex_index + 1],
+							attrib.colors[3 * corner.vertex_index + 2] };
+					}
+					else {
+						vertex.color = glm::vec3(1.f);
+					}
+
+					mesh._vertices.push_back(vertex);
+					needsNormal.push_back(corner.normal_index < 0);
+				}
+
+				mesh._indices.push_back(it->second);
+			}
+
+			bool anyMissing = std::find(needsNormal.begin(), needsNormal.end(), true) != needsNormal.end();
+			if (!anyMissing)
+				return;
+
+			for (size_t i = 0; i + 2 < mesh._indices.size(); i += 3) {
+				uint32_t a = mesh._indices[i], b = mesh._indices[i + 1], c = mesh._indices[i + 2];
+				glm::vec3 faceNormal = glm::cross(mesh._vertices[b].position - mesh._vertices[a].position,
+					mesh._vertices[c].position - mesh._vertices[a].position);
+
+				for (uint32_t v : { a, b, c }) {
+					if (needsNormal[v])
+						mesh._vertices[v].normal += faceNormal;
+				}
+			}
+
+			for (size_t v = 0; v < mesh._vertices.size(); v++) {
+				if (needsNormal[v] && glm::dot(mesh._vertices[v].normal, mesh._vertices[v].normal) > 0.f)
+					mesh._vertices[v].normal = glm::normalize(mesh._vertices[v].normal);
+			}
+		}
+	}
+
+	MeshImportResult ObjImporter::Load(const std::string& path)
+	{
+		GEARHEAD_PROFILE_FUNCTION();
+
+		MeshImportResult result;
+		result.path = path;
+
+		tinyobj::ObjReaderConfig config;
+		config.triangulate = true;
+		config.vertex_color = true;
+		config.mtl_search_path = std::filesystem::path(path).parent_path().string();
+
+		tinyobj::ObjReader reader;
+		if (!reader.ParseFromFile(path, config)) {
+			result.error = reader.Error();
+			GEARHEAD_CORE_ERROR("Failed to load {0}: {1}", path, result.error);
+			return result;
+		}
+
+		if (!reader.Warning().empty()) {
+			GEARHEAD_CORE_WARN("{0}: {1}", path, reader.Warning());
+		}
+
+		const tinyobj::attrib_t& attrib = reader.GetAttrib();
+		for (const tinyobj::shape_t& shape : reader.GetShapes()) {
+			if (shape.mesh.indices.empty())
+				continue;
+
+			ImportedMesh& imported = result.meshes.emplace_back();
+			imported.name = shape.name;
+			BuildMesh(attrib, shape, imported.mesh);
+
+			//nothing to draw, and the renderer could never upload it
+			if (imported.mesh._vertices.empty() || imported.mesh._indices.empty()) {
+				GEARHEAD_CORE_WARN("{0}: skipping empty mesh '{1}'", path, shape.name);
+				result.meshes.pop_back();
+				continue;
+			}
+
+			imported.mesh.compute_bounds();
+			if (imported.mesh._indices.size() / 3 >= MESHLET_MIN_MESH_TRIANGLES) {
+				imported.mesh.build_meshlets();
+			}
+		}
+
+		size_t vertexCount = 0, indexCount = 0, meshletCount = 0;
+		for (const ImportedMesh& imported : result.meshes) {
+			vertexCount += imported.mesh._vertices.size();
+			indexCount += imported.mesh._indices.size();
+			meshletCount += imported.mesh._meshlets.size();
+		}
+
+		GEARHEAD_CORE_INFO("Loaded {0}: {1} meshes, {2} vertices, {3} indices, {4} meshlets", path, result.meshes.size(), vertexCount, indexCount, meshletCount);
+
+		result.success = true;
+		return result;
+	}
+
+	std::future<MeshImportResult> ObjImporter::LoadAsync(const std::string& path, ThreadPool& pool)
+	{
+		return pool.Submit([path]() { return Load(path); });
+	}
+}
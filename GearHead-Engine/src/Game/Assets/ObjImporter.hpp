@@ -0,0 +1,37 @@
+#pragma once
+#include "ghpch.hpp"
+#include "Core/ThreadPool.hpp"
+#include "Game/Components/Primitives/Mesh.hpp"
+
+namespace GearHead {
+
+	class MeshCacheFile;
+
+	struct ImportedMesh {
+		std::string name;
+		// for meshes from a cache file only the bounds are filled, the streams and meshlets stay in the mapping
+		Mesh mesh;
+		uint32_t cacheIndex{ 0 };
+		// the renderer can never fit it, it stays in the scene list but is never drawn
+		bool rejected{ false };
+	};
+
+	struct MeshImportResult {
+		std::string path;
+		bool success{ false };
+		std::string error;
+		// one mesh per OBJ shape, vertices deduplicated and indexed
+		std::vector<ImportedMesh> meshes;
+		// set when the meshes were loaded from a .ghmesh, keeps the mapping alive until they are uploaded
+		std::shared_ptr<const MeshCacheFile> cache;
+	};
+
+	class GEARHEAD_API ObjImporter {
+	public:
+		// parses on the calling thread
+		static MeshImportResult Load(const std::string& path);
+
+		// parses on the pool; poll with IsReady() from the render thread and upload once it is
+		static std::future<MeshImportResult> LoadAsync(const std::string& path, ThreadPool& pool = ThreadPool::Get());
+	};
+}
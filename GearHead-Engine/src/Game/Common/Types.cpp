@@ -1,7 +1,26 @@
 #include "Types.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 
 namespace GearHead {
 
+	namespace {
+		float SignNotZero(float v)
+		{
+			return v >= 0.f ? 1.f : -1.f;
+		}
+
+		VkVertexInputAttributeDescription Attribute(uint32_t binding, uint32_t location, VkFormat format, uint32_t offset)
+		{
+			VkVertexInputAttributeDescription attribute = {};
+			attribute.binding = binding;
+			attribute.location = location;
+			attribute.format = format;
+			attribute.offset = offset;
+			return attribute;
+		}
+	}
+
 	VertexInputDescription Vertex::get_vertex_description() {
 		VertexInputDescription description;
 
@@ -40,4 +59,96 @@ namespace GearHead {
 		return description;
 	}
 
+	VertexInputDescription Vertex::get_vertex_description(VertexFormat format, bool positionOnly) {
+		VertexFormatInfo info = get_format_info(format);
+		VertexInputDescription description;
+
+		uint32_t bindingCount = positionOnly ? 1 : info.streamCount;
+		for (uint32_t stream = 0; stream < bindingCount; stream++) {
+			VkVertexInputBindingDescription binding = {};
+			binding.binding = stream;
+			binding.stride = info.strides[stream];
+			binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+			description.bindings.push_back(binding);
+		}
+
+		//same locations in every format, the shaders only differ in how they unpack them
+		switch (format) {
+		case VertexFormat::Full:
+			description.attributes.push_back(Attribute(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)));
+			if (!positionOnly) {
+				description.attributes.push_back(Attribute(0, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal)));
+				description.attributes.push_back(Attribute(0, 2, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)));
+			}
+			break;
+		case VertexFormat::Compact:
+			description.attributes.push_back(Attribute(0, 0, VK_FORMAT_R16G16B16A16_SFLOAT, 0));
+			if (!positionOnly) {
+				description.attributes.push_back(Attribute(1, 1, VK_FORMAT_R16G16_SNORM, offsetof(CompactAttributes, normal)));
+				description.attributes.push_back(Attribute(1, 2, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactAttributes, color)));
+			}
+			break;
+		}
+
+		return description;
+	}
+
+	VertexFormatInfo Vertex::get_format_info(VertexFormat format) {
+		switch (format) {
+		case VertexFormat::Compact:
+			return { 2, { sizeof(CompactPosition), sizeof(CompactAttributes) } };
+		case VertexFormat::Full:
+		default:
+			return { 1, { sizeof(Vertex), 0 } };
+		}
+	}
+
+	void Vertex::encode(VertexFormat format, std::span<const Vertex> vertices, std::span<uint8_t* const> streams) {
+		if (format == VertexFormat::Full) {
+			memcpy(streams[0], vertices.data(), vertices.size_bytes());
+			return;
+		}
+
+		CompactPosition* positions = (CompactPosition*)streams[0];
+		CompactAttributes* attributes = (CompactAttributes*)streams[1];
+		for (size_t i = 0; i < vertices.size(); i++) {
+			const Vertex& vertex = vertices[i];
+
+			positions[i].x = glm::packHalf1x16(vertex.position.x);
+			positions[i].y = glm::packHalf1x16(vertex.position.y);
+			positions[i].z = glm::packHalf1x16(vertex.position.z);
+			positions[i].w = glm::packHalf1x16(1.f);
+
+			glm::vec2 normal = encode_octahedral(vertex.normal);
+			attributes[i].normal[0] = (int16_t)glm::packSnorm1x16(normal.x);
+			attributes[i].normal[1] = (int16_t)glm::packSnorm1x16(normal.y);
+			attributes[i].color[0] = glm::packUnorm1x8(vertex.color.r);
+			attributes[i].color[1] = glm::packUnorm1x8(vertex.color.g);
+			attributes[i].color[2] = glm::packUnorm1x8(vertex.color.b);
+			attributes[i].color[3] = 255;
+		}
+	}
+
+	glm::vec2 Vertex::encode_octahedral(glm::vec3 normal) {
+		float l1 = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+		if (l1 == 0.f)
+			return { 0.f, 0.f };
+
+		normal /= l1;
+		glm::vec2 encoded(normal.x, normal.y);
+		//fold the lower hemisphere over the diagonals
+		if (normal.z < 0.f) {
+			encoded = { (1.f - glm::abs(normal.y)) * SignNotZero(normal.x), (1.f - glm::abs(normal.x)) * SignNotZero(normal.y) };
+		}
+		return encoded;
+	}
+
+	glm::vec3 Vertex::decode_octahedral(glm::vec2 encoded) {
+		glm::vec3 normal(encoded.x, encoded.y, 1.f - glm::abs(encoded.x) - glm::abs(encoded.y));
+		if (normal.z < 0.f) {
+			normal.x = (1.f - glm::abs(encoded.y)) * SignNotZero(encoded.x);
+			normal.y = (1.f - glm::abs(encoded.x)) * SignNotZero(encoded.y);
+		}
+		return glm::normalize(normal);
+	}
 }
@@ -1,21 +1,77 @@
 #pragma once
 
+#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <span>
 #include <Render/Vulkan/VkTypes.hpp>
 
 
 namespace GearHead {
 
+	enum class VertexFormat : uint32_t {
+		// Vertex as is, one interleaved 36 byte stream
+		Full = 0,
+		// stream 0: half float position (8 bytes), stream 1: octahedral snorm16 normal + unorm8 color (8 bytes).
+		// Half floats keep ~3 significant digits, positions are expected in mesh local space
+		Compact = 1
+	};
+
+	// format the renderer streams meshes in, mesh caches are cooked in it too
+	constexpr VertexFormat GEOMETRY_VERTEX_FORMAT = VertexFormat::Compact;
+
+	struct VertexFormatInfo {
+		uint32_t streamCount;
+		uint32_t strides[MAX_VERTEX_STREAMS];
+	};
+
+	struct CompactPosition {
+		uint16_t x, y, z, w;
+	};
+
+	struct CompactAttributes {
+		int16_t normal[2];
+		uint8_t color[4];
+	};
+
 	struct Vertex {
 		glm::vec3 position;
 		glm::vec3 normal;
 		glm::vec3 color;
 
 		static VertexInputDescription get_vertex_description();
+		// positionOnly keeps just location 0 from stream 0, for depth and shadow passes
+		static VertexInputDescription get_vertex_description(VertexFormat format, bool positionOnly = false);
+		static VertexFormatInfo get_format_info(VertexFormat format);
 
+		// writes the vertices into one destination per stream of the format, each sized vertices.size() * stride
+		static void encode(VertexFormat format, std::span<const Vertex> vertices, std::span<uint8_t* const> streams);
 
+		static glm::vec2 encode_octahedral(glm::vec3 normal);
+		static glm::vec3 decode_octahedral(glm::vec2 encoded);
 	};
 
+	constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+	constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+	// A cluster of at most MESHLET_MAX_TRIANGLES triangles touching at most MESHLET_MAX_VERTICES vertices,
+	// stored as a contiguous range of its mesh's indices so it can be drawn on its own. Mesh space,
+	// laid out the way cull.comp reads it and cooked into mesh caches as is
+	struct Meshlet {
+		glm::vec3 center;
+		float radius;
+		//every triangle faces away from a viewer when dot(coneApex - viewer, coneAxis) > coneCutoff * |coneApex - viewer|,
+		//coneCutoff is above 1 when the triangles spread too far for that to ever hold
+		glm::vec3 coneApex;
+		float coneCutoff;
+		glm::vec3 coneAxis;
+		//relative to the mesh's first index
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t pad[3];
+	};
 
+	static_assert(sizeof(CompactPosition) == 8);
+	static_assert(sizeof(CompactAttributes) == 8);
+	static_assert(sizeof(Meshlet) == 64);
 }
 
@@ -0,0 +1,281 @@
+#include "Mesh.hpp"
+
+#include <glm/glm.hpp>
+
+namespace GearHead {
+
+	namespace {
+		constexpr uint32_t NO_TRIANGLE = ~0u;
+
+		// vertices split at a seam (normal or colour) share a position but not an index, so edges are
+		// compared on one id per unique position
+		std::vector<uint32_t> WeldPositions(const std::vector<Vertex>& vertices)
+		{
+			std::vector<uint32_t> order(vertices.size());
+			for (uint32_t i = 0; i < order.size(); i++) {
+				order[i] = i;
+			}
+			auto less = [&](uint32_t a, uint32_t b) {
+				const glm::vec3& pa = vertices[a].position;
+				const glm::vec3& pb = vertices[b].position;
+				if (pa.x != pb.x) return pa.x < pb.x;
+				if (pa.y != pb.y) return pa.y < pb.y;
+				return pa.z < pb.z;
+			};
+			std::sort(order.begin(), order.end(), less);
+
+			std::vector<uint32_t> remap(vertices.size());
+			for (size_t i = 0; i < order.size(); i++) {
+				bool same = i > 0 && vertices[order[i]].position == vertices[order[i - 1]].position;
+				remap[order[i]] = same ? remap[order[i - 1]] : order[i];
+			}
+			return remap;
+		}
+
+		//every edge shared by exactly two triangles. Only then is a cluster facing away from the viewer
+		//guaranteed to be behind another part of the same mesh, open surfaces show their back faces
+		bool IsClosed(const Mesh& mesh)
+		{
+			std::vector<uint32_t> remap = WeldPositions(mesh._vertices);
+			const std::vector<uint32_t>& indices = mesh._indices;
+
+			std::vector<uint64_t> edges;
+			edges.reserve(indices.size());
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				for (size_t corner = 0; corner < 3; corner++) {
+					uint64_t a = remap[indices[i + corner]];
+					uint64_t b = remap[indices[i + (corner + 1) % 3]];
+					edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+
+			for (size_t i = 0; i < edges.size(); i += 2) {
+				if (i + 1 == edges.size() || edges[i] != edges[i + 1] || (i + 2 < edges.size() && edges[i + 2] == edges[i]))
+					return false;
+			}
+			return true;
+		}
+
+		void ComputeMeshletBounds(const Mesh& mesh, Meshlet& meshlet, bool closed)
+		{
+			const uint32_t* indices = mesh._indices.data() + meshlet.firstIndex;
+
+			glm::vec3 min = mesh._vertices[indices[0]].position;
+			glm::vec3 max = min;
+			for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+				min = glm::min(min, mesh._vertices[indices[i]].position);
+				max = glm::max(max, mesh._vertices[indices[i]].position);
+			}
+			meshlet.center = (min + max) * 0.5f;
+
+			float radiusSquared = 0.f;
+			for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+				glm::vec3 offset = mesh._vertices[indices[i]].position - meshlet.center;
+				radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+			}
+			meshlet.radius = std::sqrt(radiusSquared);
+
+			//no cone, never back facing
+			meshlet.coneApex = meshlet.center;
+			meshlet.coneAxis = glm::vec3(0.f, 0.f, 1.f);
+			meshlet.coneCutoff = 2.f;
+			if (!closed)
+				return;
+
+			//OBJ winding isn't reliable and the pipeline doesn't cull by it, the side the vertex normals are on is the front
+			std::array<glm::vec3, MESHLET_MAX_TRIANGLES> normals;
+			uint32_t normalCount = 0;
+			glm::vec3 axis(0.f);
+			for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+				const Vertex& v0 = mesh._vertices[indices[i]];
+				const Vertex& v1 = mesh._vertices[indices[i + 1]];
+				const Vertex& v2 = mesh._vertices[indices[i + 2]];
+
+				glm::vec3 normal = glm::cross(v1.position - v0.position, v2.position - v0.position);
+				float length = glm::length(normal);
+				//degenerate, never rasterizes
+				if (length == 0.f)
+					continue;
+
+				normal /= length;
+				if (glm::dot(normal, v0.normal + v1.normal + v2.normal) < 0.f)
+					normal = -normal;
+
+				normals[normalCount++] = normal;
+				axis += normal;
+			}
+
+			float axisLength = glm::length(axis);
+			if (normalCount == 0 || axisLength < 1e-6f)
+				return;
+			axis /= axisLength;
+
+			float minDot = 1.f;
+			for (uint32_t i = 0; i < normalCount; i++) {
+				minDot = std::min(minDot, glm::dot(normals[i], axis));
+			}
+			//close to a hemisphere of normals, the cone would almost never cull anything
+			if (minDot <= 0.1f)
+				return;
+
+			//pull the apex back along the axis until it is behind every triangle's plane
+			//(meshoptimizer's meshopt_computeClusterBounds)
+			float maxT = 0.f;
+			uint32_t normalIndex = 0;
+			for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+				const glm::vec3& p0 = mesh._vertices[indices[i]].position;
+				glm::vec3 edgeNormal = glm::cross(mesh._vertices[indices[i + 1]].position - p0, mesh._vertices[indices[i + 2]].position - p0);
+				if (glm::length(edgeNormal) == 0.f)
+					continue;
+
+				const glm::vec3& normal = normals[normalIndex++];
+				maxT = std::max(maxT, glm::dot(meshlet.center - p0, normal) / glm::dot(axis, normal));
+			}
+
+			meshlet.coneApex = meshlet.center - axis * maxT;
+			meshlet.coneAxis = axis;
+			meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+		}
+	}
+
+	void Mesh::compute_bounds()
+	{
+		if (_vertices.empty()) {
+			_bounds = {};
+			return;
+		}
+
+		_bounds.min = _vertices[0].position;
+		_bounds.max = _vertices[0].position;
+		for (const Vertex& vertex : _vertices) {
+			_bounds.min = glm::min(_bounds.min, vertex.position);
+			_bounds.max = glm::max(_bounds.max, vertex.position);
+		}
+
+		_bounds.sphereCenter = (_bounds.min + _bounds.max) * 0.5f;
+
+		float radiusSquared = 0.f;
+		for (const Vertex& vertex : _vertices) {
+			glm::vec3 offset = vertex.position - _bounds.sphereCenter;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+		_bounds.sphereRadius = std::sqrt(radiusSquared);
+	}
+
+	void Mesh::build_meshlets()
+	{
+		_meshlets.clear();
+
+		uint32_t triangleCount = uint32_t(_indices.size() / 3);
+		if (triangleCount == 0)
+			return;
+
+		//triangles around each vertex
+		std::vector<uint32_t> vertexTriangleOffsets(_vertices.size() + 1, 0);
+		for (uint32_t index : _indices) {
+			vertexTriangleOffsets[index + 1]++;
+		}
+		for (size_t vertex = 0; vertex < _vertices.size(); vertex++) {
+			vertexTriangleOffsets[vertex + 1] += vertexTriangleOffsets[vertex];
+		}
+		std::vector<uint32_t> vertexTriangles(size_t(triangleCount) * 3);
+		{
+			std::vector<uint32_t> cursor(vertexTriangleOffsets.begin(), vertexTriangleOffsets.end() - 1);
+			for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					vertexTriangles[cursor[_indices[triangle * 3 + corner]]++] = triangle;
+				}
+			}
+		}
+
+		std::vector<uint8_t> emitted(triangleCount, 0);
+		//meshlet a vertex was last added to, so membership needs no clearing between meshlets
+		std::vector<uint32_t> vertexMeshlet(_vertices.size(), ~0u);
+		std::vector<uint32_t> reordered;
+		reordered.reserve(size_t(triangleCount) * 3);
+
+		std::vector<uint32_t> candidates;
+		uint32_t seed = 0;
+
+		//grow each meshlet greedily from a seed across shared vertices, preferring triangles that add the fewest
+		//new vertices and then the ones closest to its centroid, so clusters come out compact for culling
+		while (true) {
+			while (seed < triangleCount && emitted[seed])
+				seed++;
+			if (seed == triangleCount)
+				break;
+
+			uint32_t meshletIndex = (uint32_t)_meshlets.size();
+			Meshlet& meshlet = _meshlets.emplace_back();
+			meshlet.firstIndex = (uint32_t)reordered.size();
+
+			uint32_t vertexCount = 0;
+			uint32_t meshletTriangles = 0;
+			glm::vec3 positionSum(0.f);
+			candidates.clear();
+
+			uint32_t next = seed;
+			while (next != NO_TRIANGLE) {
+				emitted[next] = 1;
+				meshletTriangles++;
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					uint32_t vertex = _indices[next * 3 + corner];
+					reordered.push_back(vertex);
+					if (vertexMeshlet[vertex] == meshletIndex)
+						continue;
+
+					vertexMeshlet[vertex] = meshletIndex;
+					vertexCount++;
+					positionSum += _vertices[vertex].position;
+					for (uint32_t i = vertexTriangleOffsets[vertex]; i < vertexTriangleOffsets[vertex + 1]; i++) {
+						if (!emitted[vertexTriangles[i]])
+							candidates.push_back(vertexTriangles[i]);
+					}
+				}
+
+				if (meshletTriangles == MESHLET_MAX_TRIANGLES)
+					break;
+
+				glm::vec3 centroid = positionSum / float(vertexCount);
+				next = NO_TRIANGLE;
+				uint32_t bestNewVertices = 4;
+				float bestDistance = std::numeric_limits<float>::max();
+				for (size_t i = 0; i < candidates.size();) {
+					uint32_t triangle = candidates[i];
+					if (emitted[triangle]) {
+						candidates[i] = candidates.back();
+						candidates.pop_back();
+						continue;
+					}
+					i++;
+
+					const uint32_t* corners = &_indices[triangle * 3];
+					uint32_t newVertices = 0;
+					for (uint32_t corner = 0; corner < 3; corner++) {
+						newVertices += vertexMeshlet[corners[corner]] != meshletIndex ? 1 : 0;
+					}
+					if (vertexCount + newVertices > MESHLET_MAX_VERTICES || newVertices > bestNewVertices)
+						continue;
+
+					glm::vec3 offset = (_vertices[corners[0]].position + _vertices[corners[1]].position + _vertices[corners[2]].position) / 3.f - centroid;
+					float distance = glm::dot(offset, offset);
+					if (newVertices < bestNewVertices || distance < bestDistance) {
+						next = triangle;
+						bestNewVertices = newVertices;
+						bestDistance = distance;
+					}
+				}
+			}
+
+			meshlet.indexCount = (uint32_t)reordered.size() - meshlet.firstIndex;
+		}
+
+		_indices = std::move(reordered);
+
+		bool closed = IsClosed(*this);
+		for (Meshlet& meshlet : _meshlets) {
+			ComputeMeshletBounds(*this, meshlet, closed);
+		}
+	}
+}
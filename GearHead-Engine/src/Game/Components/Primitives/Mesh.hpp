@@ -2,11 +2,34 @@
 #include "ghpch.hpp"
 #include <Game/Common/Types.hpp>
 #include "Render/Vulkan/VkTypes.hpp"
+#include "Render/Vulkan/VkUpload.hpp"
 
 namespace GearHead {
+
+	struct MeshBounds {
+		glm::vec3 min{ 0.f };
+		glm::vec3 max{ 0.f };
+		//centered on the box, for cheap culling
+		glm::vec3 sphereCenter{ 0.f };
+		float sphereRadius{ 0.f };
+	};
+
+	//below this many triangles a mesh is cheaper to draw whole than to cull cluster by cluster
+	constexpr uint32_t MESHLET_MIN_MESH_TRIANGLES = 4096;
+
 	class GEARHEAD_API Mesh {
 	public:
 		std::vector<Vertex> _vertices;
-		AllocatedBuffer _vertexBuffer;
+		std::vector<uint32_t> _indices;
+		MeshBounds _bounds;
+		//empty unless build_meshlets() ran, each one covers a contiguous range of _indices
+		std::vector<Meshlet> _meshlets;
+
+		//range inside the renderer's shared vertex/index buffers, invalid until uploaded
+		MeshAllocation _allocation;
+
+		void compute_bounds();
+		//splits the triangles into meshlets and reorders _indices to match
+		void build_meshlets();
 	};
 }
@@ -2,6 +2,8 @@
 //Application use ONLY
 
 #include "Core/Log.hpp"
+#include "Core/Profiler.hpp"
+#include "Core/ThreadPool.hpp"
 #include "Core/Application.hpp"
 
 #include "Core/EntryPoint.hpp"
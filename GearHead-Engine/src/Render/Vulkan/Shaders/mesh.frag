@@ -0,0 +1,16 @@
+//GLSL version to use
+#version 460
+
+layout (location = 0) in vec3 inNormal;
+layout (location = 1) in vec3 inColor;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main() 
+{
+	//fixed directional light until there's a scene description to take one from
+	vec3 lightDir = normalize(vec3(0.3, 1.0, 0.5));
+	float light = max(dot(normalize(inNormal), lightDir), 0.0) * 0.8 + 0.2;
+
+	outFragColor = vec4(inColor * light, 1.0);
+}
@@ -0,0 +1,69 @@
+//GLSL version to use
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+//VertexFormat::Compact, pulled straight from the geometry buffers instead of going through vertex input.
+//One uvec2 per vertex in each stream, see CompactPosition and CompactAttributes
+layout(buffer_reference, std430, buffer_reference_align = 8) readonly buffer PositionStream {
+	uvec2 positions[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 8) readonly buffer AttributeStream {
+	uvec2 attributes[];
+};
+
+//GPUInstance, only the model matrix matters here
+struct Instance {
+	mat4 model;
+	vec4 boundingSphere;
+	uint indexCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint firstMeshlet;
+	uint meshletCount;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer InstanceBuffer {
+	Instance instances[];
+};
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec3 outColor;
+
+//push constants block, GPUDrawPushConstants
+layout( push_constant ) uniform constants
+{
+ mat4 viewProj;
+ PositionStream positionStream;
+ AttributeStream attributeStream;
+ InstanceBuffer instanceBuffer;
+} PushConstants;
+
+//octahedral normals, the inverse of Vertex::encode_octahedral
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0) {
+		n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
+void main() 
+{
+	//gl_VertexIndex already has the draw's vertexOffset added
+	uvec2 packedPosition = PushConstants.positionStream.positions[gl_VertexIndex];
+	uvec2 packedAttributes = PushConstants.attributeStream.attributes[gl_VertexIndex];
+
+	vec3 position = vec3(unpackHalf2x16(packedPosition.x), unpackHalf2x16(packedPosition.y).x);
+	vec2 normal = unpackSnorm2x16(packedAttributes.x);
+	vec4 color = unpackUnorm4x8(packedAttributes.y);
+
+	//cull.comp wrote the instance's index as the draw's firstInstance
+	mat4 model = PushConstants.instanceBuffer.instances[gl_InstanceIndex].model;
+
+	gl_Position = PushConstants.viewProj * model * vec4(position, 1.0);
+
+	outNormal = mat3(model) * decodeOctahedral(normal);
+	outColor = color.rgb;
+}
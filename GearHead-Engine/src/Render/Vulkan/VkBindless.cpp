@@ -0,0 +1,212 @@
+#include "VkBindless.hpp"
+#include "VkDescriptors.hpp"
+#include "Core/Core.hpp"
+
+namespace GearHead {
+
+	void BindlessHeap::init(VkDevice device, VkPhysicalDevice gpu)
+	{
+		_device = device;
+
+		VkPhysicalDeviceVulkan12Properties properties12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES };
+		VkPhysicalDeviceProperties2 properties{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+		properties.pNext = &properties12;
+		vkGetPhysicalDeviceProperties2(gpu, &properties);
+
+		//the whole set is visible to every stage, so the per stage limits apply to it as a whole
+		_tables[(uint32_t)BindlessType::SampledImage].capacity = std::min({ BINDLESS_SAMPLED_IMAGES,
+			properties12.maxDescriptorSetUpdateAfterBindSampledImages, properties12.maxPerStageDescriptorUpdateAfterBindSampledImages });
+		_tables[(uint32_t)BindlessType::StorageImage].capacity = std::min({ BINDLESS_STORAGE_IMAGES,
+			properties12.maxDescriptorSetUpdateAfterBindStorageImages, properties12.maxPerStageDescriptorUpdateAfterBindStorageImages });
+		_tables[(uint32_t)BindlessType::StorageBuffer].capacity = std::min({ BINDLESS_STORAGE_BUFFERS,
+			properties12.maxDescriptorSetUpdateAfterBindStorageBuffers, properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+		_bindingTypes = {
+			VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+			VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_DESCRIPTOR_TYPE_SAMPLER,
+		};
+
+		//baked into the layout, shaders pair them with whichever image they sample
+		VkSamplerCreateInfo samplerInfo{ .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		GEARHEAD_VKSUCCESS_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &_samplers[(uint32_t)BindlessSampler::Linear]));
+
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		GEARHEAD_VKSUCCESS_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &_samplers[(uint32_t)BindlessSampler::Nearest]));
+
+		DescriptorLayoutBuilder builder;
+		for (uint32_t binding = 0; binding < (uint32_t)BindlessType::Count; binding++) {
+			builder.add_binding(binding, _bindingTypes[binding], _tables[binding].capacity, VK_SHADER_STAGE_ALL);
+		}
+		builder.add_binding(BINDLESS_SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER, (uint32_t)_samplers.size(), VK_SHADER_STAGE_ALL);
+		builder.bindings.back().pImmutableSamplers = _samplers.data();
+
+		//slots can be written while the set is bound, and the ones never written are never read
+		constexpr VkDescriptorBindingFlags tableFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+		std::array<VkDescriptorBindingFlags, BINDLESS_SAMPLER_BINDING + 1> bindingFlags = { tableFlags, tableFlags, tableFlags, 0 };
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO };
+		flagsInfo.bindingCount = (uint32_t)bindingFlags.size();
+		flagsInfo.pBindingFlags = bindingFlags.data();
+
+		_layout = builder.build(device, 0, &flagsInfo, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
+
+		std::array<VkDescriptorPoolSize, BINDLESS_SAMPLER_BINDING + 1> poolSizes;
+		for (uint32_t binding = 0; binding < (uint32_t)BindlessType::Count; binding++) {
+			poolSizes[binding] = { _bindingTypes[binding], _tables[binding].capacity };
+		}
+		poolSizes[BINDLESS_SAMPLER_BINDING] = { VK_DESCRIPTOR_TYPE_SAMPLER, (uint32_t)_samplers.size() };
+
+		VkDescriptorPoolCreateInfo poolInfo{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
+		poolInfo.pPoolSizes = poolSizes.data();
+		GEARHEAD_VKSUCCESS_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &_pool));
+
+		VkDescriptorSetAllocateInfo allocInfo{ .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+		allocInfo.descriptorPool = _pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &_layout;
+		GEARHEAD_VKSUCCESS_CHECK(vkAllocateDescriptorSets(device, &allocInfo, &_set));
+
+		GEARHEAD_CORE_INFO("Bindless heap: {0} sampled images, {1} storage images, {2} storage buffers",
+			capacity(BindlessType::SampledImage), capacity(BindlessType::StorageImage), capacity(BindlessType::StorageBuffer));
+	}
+
+	void BindlessHeap::destroy()
+	{
+		vkDestroyDescriptorPool(_device, _pool, nullptr);
+		vkDestroyDescriptorSetLayout(_device, _layout, nullptr);
+		for (VkSampler sampler : _samplers) {
+			vkDestroySampler(_device, sampler, nullptr);
+		}
+
+		_pool = VK_NULL_HANDLE;
+		_layout = VK_NULL_HANDLE;
+		_set = VK_NULL_HANDLE;
+		_tables = {};
+		_released.clear();
+		_pending.clear();
+	}
+
+	uint32_t BindlessHeap::add_sampled_image(VkImageView view, VkImageLayout layout)
+	{
+		uint32_t index = allocate(BindlessType::SampledImage);
+		if (index != INVALID_BINDLESS_INDEX) {
+			update_sampled_image(index, view, layout);
+		}
+		return index;
+	}
+
+	uint32_t BindlessHeap::add_storage_image(VkImageView view)
+	{
+		uint32_t index = allocate(BindlessType::StorageImage);
+		if (index != INVALID_BINDLESS_INDEX) {
+			update_storage_image(index, view);
+		}
+		return index;
+	}
+
+	uint32_t BindlessHeap::add_storage_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+	{
+		uint32_t index = allocate(BindlessType::StorageBuffer);
+		if (index != INVALID_BINDLESS_INDEX) {
+			update_storage_buffer(index, buffer, offset, range);
+		}
+		return index;
+	}
+
+	void BindlessHeap::update_sampled_image(uint32_t index, VkImageView view, VkImageLayout layout)
+	{
+		VkDescriptorImageInfo imageInfo{ .imageView = view, .imageLayout = layout };
+		write(BindlessType::SampledImage, index, &imageInfo, nullptr);
+	}
+
+	void BindlessHeap::update_storage_image(uint32_t index, VkImageView view)
+	{
+		VkDescriptorImageInfo imageInfo{ .imageView = view, .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+		write(BindlessType::StorageImage, index, &imageInfo, nullptr);
+	}
+
+	void BindlessHeap::update_storage_buffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+	{
+		VkDescriptorBufferInfo bufferInfo{ .buffer = buffer, .offset = offset, .range = range };
+		write(BindlessType::StorageBuffer, index, nullptr, &bufferInfo);
+	}
+
+	void BindlessHeap::free(BindlessType type, uint32_t index)
+	{
+		if (index == INVALID_BINDLESS_INDEX)
+			return;
+
+		_released.push_back({ type, index });
+	}
+
+	void BindlessHeap::submit(uint64_t timelineValue)
+	{
+		for (auto [type, index] : _released) {
+			_pending.push_back({ type, index, timelineValue });
+		}
+		_released.clear();
+	}
+
+	void BindlessHeap::retire(uint64_t completedValue)
+	{
+		while (!_pending.empty() && _pending.front().timelineValue <= completedValue) {
+			Table& table = _tables[(uint32_t)_pending.front().type];
+			table.free.push_back(_pending.front().index);
+			table.used--;
+			_pending.pop_front();
+		}
+	}
+
+	uint32_t BindlessHeap::allocate(BindlessType type)
+	{
+		Table& table = _tables[(uint32_t)type];
+
+		uint32_t index;
+		if (!table.free.empty()) {
+			index = table.free.back();
+			table.free.pop_back();
+		}
+		else if (table.next < table.capacity) {
+			index = table.next++;
+		}
+		else {
+			GEARHEAD_CORE_LOG_RATE_LIMITED(ERROR, 1000, "Bindless table {0} is full ({1} slots)", (uint32_t)type, table.capacity);
+			return INVALID_BINDLESS_INDEX;
+		}
+
+		table.used++;
+		return index;
+	}
+
+	void BindlessHeap::write(BindlessType type, uint32_t index, const VkDescriptorImageInfo* image, const VkDescriptorBufferInfo* buffer)
+	{
+		VkWriteDescriptorSet write{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+		write.dstSet = _set;
+		write.dstBinding = (uint32_t)type;
+		write.dstArrayElement = index;
+		write.descriptorCount = 1;
+		write.descriptorType = _bindingTypes[(uint32_t)type];
+		write.pImageInfo = image;
+		write.pBufferInfo = buffer;
+
+		vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "ghpch.hpp"
+
+namespace GearHead {
+
+	// Binding numbers inside the bindless set, shaders index the arrays with what add_*() returned:
+	//   layout(set = 0, binding = 0) uniform texture2D sampledImages[];
+	//   layout(set = 0, binding = 1) uniform writeonly image2D storageImages[];
+	//   layout(set = 0, binding = 2) buffer ... storageBuffers[];
+	//   layout(set = 0, binding = 3) uniform sampler samplers[];
+	enum class BindlessType : uint32_t {
+		SampledImage = 0,
+		StorageImage = 1,
+		StorageBuffer = 2,
+		Count
+	};
+
+	enum class BindlessSampler : uint32_t {
+		Linear = 0,
+		Nearest = 1,
+		Count
+	};
+
+	constexpr uint32_t BINDLESS_SET = 0;
+	constexpr uint32_t BINDLESS_SAMPLER_BINDING = 3;
+	constexpr uint32_t INVALID_BINDLESS_INDEX = ~0u;
+
+	//upper bounds, clamped to what the device allows for update after bind
+	constexpr uint32_t BINDLESS_SAMPLED_IMAGES = 16384;
+	constexpr uint32_t BINDLESS_STORAGE_IMAGES = 1024;
+	constexpr uint32_t BINDLESS_STORAGE_BUFFERS = 16384;
+
+	// One update after bind, partially bound descriptor set holding every sampled image, storage image
+	// and storage buffer the renderer uses, bound once per pass. Slots come from a free list per type
+	// and a freed slot is only handed out again once the submissions that could read it have retired,
+	// the same submit/retire pattern as the staging ring.
+	class BindlessHeap {
+	public:
+		void init(VkDevice device, VkPhysicalDevice gpu);
+		void destroy();
+
+		//INVALID_BINDLESS_INDEX when that table is full
+		uint32_t add_sampled_image(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		uint32_t add_storage_image(VkImageView view);
+		uint32_t add_storage_buffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+		//rewrites a slot in place, only once nothing in flight reads the old resource through it
+		void update_sampled_image(uint32_t index, VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		void update_storage_image(uint32_t index, VkImageView view);
+		void update_storage_buffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+		//the slot comes back once every submission recorded before the next submit() has retired
+		void free(BindlessType type, uint32_t index);
+		void submit(uint64_t timelineValue);
+		void retire(uint64_t completedValue);
+
+		VkDescriptorSetLayout layout() const { return _layout; }
+		VkDescriptorSet set() const { return _set; }
+		//indexed by binding, for checking reflected shaders against the set
+		std::span<const VkDescriptorType> binding_types() const { return _bindingTypes; }
+
+		uint32_t capacity(BindlessType type) const { return _tables[(uint32_t)type].capacity; }
+		uint32_t used(BindlessType type) const { return _tables[(uint32_t)type].used; }
+
+	private:
+		struct Table {
+			uint32_t capacity{ 0 };
+			uint32_t used{ 0 };
+			//never handed out yet, everything below it is either in use or on the free list
+			uint32_t next{ 0 };
+			std::vector<uint32_t> free;
+		};
+
+		struct PendingFree {
+			BindlessType type;
+			uint32_t index;
+			uint64_t timelineValue;
+		};
+
+		uint32_t allocate(BindlessType type);
+		void write(BindlessType type, uint32_t index, const VkDescriptorImageInfo* image, const VkDescriptorBufferInfo* buffer);
+
+		VkDevice _device{ VK_NULL_HANDLE };
+		VkDescriptorPool _pool{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout _layout{ VK_NULL_HANDLE };
+		VkDescriptorSet _set{ VK_NULL_HANDLE };
+		std::array<VkSampler, (size_t)BindlessSampler::Count> _samplers{};
+		std::array<VkDescriptorType, BINDLESS_SAMPLER_BINDING + 1> _bindingTypes{};
+
+		std::array<Table, (size_t)BindlessType::Count> _tables;
+		//freed since the last submit, not tagged with a timeline value yet
+		std::vector<std::pair<BindlessType, uint32_t>> _released;
+		std::deque<PendingFree> _pending;
+	};
+}
@@ -0,0 +1,65 @@
+#include "VkBuffers.hpp"
+#include "Core/Core.hpp"
+#include "ghpch.hpp"
+
+namespace VkUtil {
+
+	GearHead::AllocatedBuffer create_buffer(VmaAllocator allocator, size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage,
+		std::span<const uint32_t> queueFamilies)
+	{
+		VkBufferCreateInfo bufferInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+		bufferInfo.pNext = nullptr;
+		bufferInfo.size = allocSize;
+		bufferInfo.usage = usage;
+
+		if (queueFamilies.size() > 1) {
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = (uint32_t)queueFamilies.size();
+			bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+		}
+
+		VmaAllocationCreateInfo vmaallocInfo = {};
+		vmaallocInfo.usage = memoryUsage;
+
+		//anything the cpu can see stays mapped for its whole lifetime
+		if (memoryUsage == VMA_MEMORY_USAGE_CPU_ONLY || memoryUsage == VMA_MEMORY_USAGE_CPU_TO_GPU || memoryUsage == VMA_MEMORY_USAGE_GPU_TO_CPU) {
+			vmaallocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		}
+
+		GearHead::AllocatedBuffer newBuffer{};
+		GEARHEAD_VKSUCCESS_CHECK(vmaCreateBuffer(allocator, &bufferInfo, &vmaallocInfo, &newBuffer._buffer, &newBuffer._allocation, &newBuffer._info));
+
+		//shaders reach it through this instead of a descriptor
+		if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
+			VmaAllocatorInfo allocatorInfo;
+			vmaGetAllocatorInfo(allocator, &allocatorInfo);
+
+			VkBufferDeviceAddressInfo addressInfo{ .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
+			addressInfo.buffer = newBuffer._buffer;
+			newBuffer._address = vkGetBufferDeviceAddress(allocatorInfo.device, &addressInfo);
+		}
+
+		return newBuffer;
+	}
+
+	void destroy_buffer(VmaAllocator allocator, const GearHead::AllocatedBuffer& buffer)
+	{
+		vmaDestroyBuffer(allocator, buffer._buffer, buffer._allocation);
+	}
+
+	void memory_barrier(VkCommandBuffer cmd, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+	{
+		VkMemoryBarrier2 barrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+		barrier.srcStageMask = srcStage;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstStageMask = dstStage;
+		barrier.dstAccessMask = dstAccess;
+
+		VkDependencyInfo depInfo{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+		depInfo.memoryBarrierCount = 1;
+		depInfo.pMemoryBarriers = &barrier;
+
+		vkCmdPipelineBarrier2(cmd, &depInfo);
+	}
+
+}
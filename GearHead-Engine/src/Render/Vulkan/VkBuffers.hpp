@@ -0,0 +1,18 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include <span>
+
+namespace VkUtil {
+
+	//host visible memory comes back mapped, and asking for VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT fills in _address.
+	//more than one queue family shares the buffer between them instead of needing ownership transfers
+	GearHead::AllocatedBuffer create_buffer(VmaAllocator allocator, size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage,
+		std::span<const uint32_t> queueFamilies = {});
+
+	void destroy_buffer(VmaAllocator allocator, const GearHead::AllocatedBuffer& buffer);
+
+	//global, for when a pass hands buffers (or images that stay in one layout) to the next
+	void memory_barrier(VkCommandBuffer cmd, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess);
+
+}
@@ -1,17 +1,45 @@
 #include "VkDescriptors.hpp"
+#include "Core/Core.hpp"
 
 namespace GearHead
 {
-	void DescriptorLayoutBuilder::add_binding(uint32_t binding, VkDescriptorType type)
+	void DescriptorLayoutBuilder::add_binding(uint32_t binding, VkDescriptorType type, uint32_t count, VkShaderStageFlags stages)
 	{
+		for (VkDescriptorSetLayoutBinding& existing : bindings) {
+			if (existing.binding != binding)
+				continue;
+
+			if (existing.descriptorType != type) {
+				GEARHEAD_CORE_ERROR("Binding {0} declared as descriptor type {1} and {2}, keeping the first", binding, (uint32_t)existing.descriptorType, (uint32_t)type);
+			}
+			existing.descriptorCount = std::max(existing.descriptorCount, count);
+			existing.stageFlags |= stages;
+			return;
+		}
+
 		VkDescriptorSetLayoutBinding newbind{};
 		newbind.binding = binding;
-		newbind.descriptorCount = 1;
+		newbind.descriptorCount = count;
 		newbind.descriptorType = type;
+		newbind.stageFlags = stages;
 
 		bindings.push_back(newbind);
 	}
 
+	void DescriptorLayoutBuilder::add_bindings(const ShaderReflection& reflection, uint32_t set)
+	{
+		for (const ShaderBinding& binding : reflection.bindings) {
+			if (binding.set != set)
+				continue;
+
+			//runtime sized arrays need a variable count layout, which nothing builds yet
+			if (binding.count == 0) {
+				GEARHEAD_CORE_WARN("Unsized descriptor array at set {0} binding {1}, sizing it to 1", set, binding.binding);
+			}
+			add_binding(binding.binding, binding.type, std::max(binding.count, 1u), reflection.stage);
+		}
+	}
+
 	void DescriptorLayoutBuilder::clear() {
 		bindings.clear();
 	}
@@ -35,48 +63,101 @@ namespace GearHead
 		return set;
 	}
 
-	void DescriptorAllocator::init_pool(VkDevice device, uint32_t maxSets, std::span<PoolSizeRatio> poolRatios)
+	void DescriptorAllocator::init(VkDevice device, uint32_t initialSets, std::span<const PoolSizeRatio> poolRatios)
 	{
-		std::vector<VkDescriptorPoolSize> poolSizes;
-		for (PoolSizeRatio ratio : poolRatios) {
-			poolSizes.push_back(VkDescriptorPoolSize{
-				.type = ratio.type,
-				.descriptorCount = uint32_t(ratio.ratio * maxSets)
-				});
-		}
+		ratios.assign(poolRatios.begin(), poolRatios.end());
 
-		VkDescriptorPoolCreateInfo pool_info = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
-		pool_info.flags = 0;
-		pool_info.maxSets = maxSets;
-		pool_info.poolSizeCount = (uint32_t)poolSizes.size();
-		pool_info.pPoolSizes = poolSizes.data();
+		readyPools.push_back(create_pool(device, initialSets));
 
-		vkCreateDescriptorPool(device, &pool_info, nullptr, &pool);
+		//the next pool gets made bigger, so a busy frame settles on a few large pools
+		setsPerPool = std::min(uint32_t(initialSets * 1.5f), MAX_SETS_PER_POOL);
 	}
 
-	void DescriptorAllocator::clear_descriptors(VkDevice device)
+	void DescriptorAllocator::clear_pools(VkDevice device)
 	{
-		vkResetDescriptorPool(device, pool, 0);
+		for (VkDescriptorPool pool : readyPools) {
+			vkResetDescriptorPool(device, pool, 0);
+		}
+		for (VkDescriptorPool pool : fullPools) {
+			vkResetDescriptorPool(device, pool, 0);
+			readyPools.push_back(pool);
+		}
+		fullPools.clear();
 	}
 
-	void DescriptorAllocator::destroy_pool(VkDevice device)
+	void DescriptorAllocator::destroy_pools(VkDevice device)
 	{
-		vkDestroyDescriptorPool(device, pool, nullptr);
+		for (VkDescriptorPool pool : readyPools) {
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+		for (VkDescriptorPool pool : fullPools) {
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+		readyPools.clear();
+		fullPools.clear();
 	}
 
-	VkDescriptorSet DescriptorAllocator::allocate(VkDevice device, VkDescriptorSetLayout layout)
+	VkDescriptorSet DescriptorAllocator::allocate(VkDevice device, VkDescriptorSetLayout layout, void* pNext)
 	{
+		VkDescriptorPool pool = get_pool(device);
+
 		VkDescriptorSetAllocateInfo allocInfo = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
-		allocInfo.pNext = nullptr;
+		allocInfo.pNext = pNext;
 		allocInfo.descriptorPool = pool;
 		allocInfo.descriptorSetCount = 1;
 		allocInfo.pSetLayouts = &layout;
 
 		VkDescriptorSet ds;
-		GEARHEAD_VKSUCCESS_CHECK(vkAllocateDescriptorSets(device, &allocInfo, &ds));
+		VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &ds);
+
+		//this pool is done until the next clear, try once more with a fresh one
+		if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+			fullPools.push_back(pool);
 
+			pool = get_pool(device);
+			allocInfo.descriptorPool = pool;
+
+			GEARHEAD_VKSUCCESS_CHECK(vkAllocateDescriptorSets(device, &allocInfo, &ds));
+		}
+		else {
+			GEARHEAD_VKSUCCESS_CHECK(result);
+		}
+
+		readyPools.push_back(pool);
 		return ds;
 	}
 
+	VkDescriptorPool DescriptorAllocator::get_pool(VkDevice device)
+	{
+		if (!readyPools.empty()) {
+			VkDescriptorPool pool = readyPools.back();
+			readyPools.pop_back();
+			return pool;
+		}
 
+		VkDescriptorPool pool = create_pool(device, setsPerPool);
+		setsPerPool = std::min(uint32_t(setsPerPool * 1.5f), MAX_SETS_PER_POOL);
+		return pool;
+	}
+
+	VkDescriptorPool DescriptorAllocator::create_pool(VkDevice device, uint32_t setCount)
+	{
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (PoolSizeRatio ratio : ratios) {
+			poolSizes.push_back(VkDescriptorPoolSize{
+				.type = ratio.type,
+				.descriptorCount = std::max(1u, uint32_t(ratio.ratio * setCount))
+				});
+		}
+
+		VkDescriptorPoolCreateInfo pool_info = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+		pool_info.flags = 0;
+		pool_info.maxSets = setCount;
+		pool_info.poolSizeCount = (uint32_t)poolSizes.size();
+		pool_info.pPoolSizes = poolSizes.data();
+
+		VkDescriptorPool pool;
+		GEARHEAD_VKSUCCESS_CHECK(vkCreateDescriptorPool(device, &pool_info, nullptr, &pool));
+		return pool;
+	}
 }
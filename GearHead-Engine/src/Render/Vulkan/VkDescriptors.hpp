@@ -1,5 +1,6 @@
 #pragma once
 #include "VkTypes.hpp"
+#include "VkShaderRegistry.hpp"
 #include "ghpch.hpp"
 
 namespace GearHead
@@ -8,11 +9,16 @@ namespace GearHead
 
 		std::vector<VkDescriptorSetLayoutBinding> bindings;
 
-		void add_binding(uint32_t binding, VkDescriptorType type);
+		//adding a binding that's already there merges the stages and keeps the larger count
+		void add_binding(uint32_t binding, VkDescriptorType type, uint32_t count = 1, VkShaderStageFlags stages = 0);
+		//every binding the shader declares in this set, visible to the shader's stage
+		void add_bindings(const ShaderReflection& reflection, uint32_t set);
 		void clear();
 		VkDescriptorSetLayout build(VkDevice device, VkShaderStageFlags shaderStages, void* pNext = nullptr, VkDescriptorSetLayoutCreateFlags flags = 0);
 	};
 
+	// Hands out sets from a list of pools, making a bigger pool whenever the current ones run out.
+	// clear_pools() resets every pool at once, which is what makes it cheap for sets that only live for a frame
 	struct DescriptorAllocator {
 
 		struct PoolSizeRatio {
@@ -20,13 +26,25 @@ namespace GearHead
 			float ratio;
 		};
 
-		VkDescriptorPool pool;
+		static constexpr uint32_t MAX_SETS_PER_POOL = 4092;
 
-		void init_pool(VkDevice device, uint32_t maxSets, std::span<PoolSizeRatio> poolRatios);
-		void clear_descriptors(VkDevice device);
-		void destroy_pool(VkDevice device);
+		void init(VkDevice device, uint32_t initialSets, std::span<const PoolSizeRatio> poolRatios);
+		//every set allocated so far becomes invalid, only once the GPU is done with them
+		void clear_pools(VkDevice device);
+		void destroy_pools(VkDevice device);
 
-		VkDescriptorSet allocate(VkDevice device, VkDescriptorSetLayout layout);
+		VkDescriptorSet allocate(VkDevice device, VkDescriptorSetLayout layout, void* pNext = nullptr);
+
+		size_t pool_count() const { return fullPools.size() + readyPools.size(); }
+
+	private:
+		VkDescriptorPool get_pool(VkDevice device);
+		VkDescriptorPool create_pool(VkDevice device, uint32_t setCount);
+
+		std::vector<PoolSizeRatio> ratios;
+		std::vector<VkDescriptorPool> fullPools;
+		std::vector<VkDescriptorPool> readyPools;
+		uint32_t setsPerPool{ 0 };
 	};
 }
 
@@ -0,0 +1,193 @@
+#include "ghpch.hpp"
+
+//Internal Includes
+#include "VkInit.hpp"
+#include "VkHeadlessWindow.hpp"
+#include "VkImages.hpp"
+#include "VkBuffers.hpp"
+
+namespace GearHead {
+
+	VkHeadlessWindow::VkHeadlessWindow(const WindowProps& props) { Init(props); }
+
+	void VkHeadlessWindow::Init(const WindowProps& props)
+	{
+		mData.props = props;
+		mData.vsync = false;
+		_headless = true;
+		_framesInFlight = std::clamp(props.FramesInFlight, 1U, MAX_FRAMES_IN_FLIGHT);
+
+		GEARHEAD_CORE_INFO("Creating headless target {0} ({1}, {2})", props.Title, props.Width, props.Height);
+
+		//Vulkan, same as the windowed path minus the swapchain and ImGUI
+		auto initStart = std::chrono::high_resolution_clock::now();
+
+		InitVulkan();
+		InitDrawImage();
+		InitCommands();
+		InitSyncStructures();
+		CalibrateGpuClock();
+		InitGeometry();
+		InitDescriptors();
+		InitPipelineCache();
+		InitPipelines();
+
+		//captured frames have to be deterministic, no placeholders
+		PollPipelines(true);
+
+		_startupStats.initMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - initStart).count();
+		GEARHEAD_CORE_INFO("Renderer initialized in {0:.2f} ms", _startupStats.initMs);
+
+		isInitialized = true;
+	}
+
+	VkHeadlessWindow::~VkHeadlessWindow()
+	{
+		if (_frameNumber > 0) {
+			GEARHEAD_CORE_INFO("Headless frames: {0}, avg {1:.3f} ms, min {2:.3f} ms, max {3:.3f} ms",
+				_frameNumber, _totalFrameMs / _frameNumber, _minFrameMs, _maxFrameMs);
+		}
+
+		if (isInitialized && _readbackBuffer._buffer != VK_NULL_HANDLE) {
+			vkDeviceWaitIdle(_device);
+			VkUtil::destroy_buffer(_allocator, _readbackBuffer);
+		}
+	}
+
+	void VkHeadlessWindow::OnUpdate()
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		DrawFrame();
+
+		auto end = std::chrono::high_resolution_clock::now();
+		double frameMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+		_totalFrameMs += frameMs;
+		_minFrameMs = std::min(_minFrameMs, frameMs);
+		_maxFrameMs = std::max(_maxFrameMs, frameMs);
+	}
+
+	void VkHeadlessWindow::DrawFrame()
+	{
+		WaitForFrame(GetCurrentFrame());
+
+		GetCurrentFrame()._deletionQueue.flush();
+		GetCurrentFrame()._frameDescriptors.clear_pools(_device);
+
+		PollPipelines();
+		PollMeshImports();
+
+		GEARHEAD_VKSUCCESS_CHECK(vkResetCommandBuffer(GetCurrentFrame()._buffer, 0));
+
+		//same render scale as the windowed path, the capture is what it would have rendered before the blit
+		_drawExtent = ScaledDrawExtent(mData.toVkExtent2D());
+
+		UpdateScene();
+
+		std::optional<VkSemaphoreSubmitInfo> computeWait;
+		if (_asyncCompute) {
+			computeWait = SubmitComputePass();
+		}
+
+		VkCommandBuffer cmd = GetCurrentFrame()._buffer;
+
+		{
+			GEARHEAD_PROFILE_SCOPE("Record Commands");
+
+			VkCommandBufferBeginInfo cmdBeginInfo = VkInit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+			GEARHEAD_VKSUCCESS_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+			if (_meshUploader.has_pending()) {
+				uint32_t uploadScope = _gpuProfiler.begin_scope(cmd, "Upload");
+				_meshUploader.record(cmd);
+				_gpuProfiler.end_scope(cmd, uploadScope);
+			}
+
+			if (!_asyncCompute) {
+				_drawImageScope = _gpuProfiler.begin_scope(cmd, GPU_SCOPE_DRAW_IMAGE);
+			}
+
+			DrawScene(cmd);
+
+			_gpuProfiler.end_scope(cmd, _drawImageScope);
+
+			// leave the draw image ready to be copied out by ReadbackFrame
+			VkUtil::transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+			GEARHEAD_VKSUCCESS_CHECK(vkEndCommandBuffer(cmd));
+		}
+
+		VkCommandBufferSubmitInfo cmdinfo = VkInit::command_buffer_submit_info(cmd);
+
+		GetCurrentFrame()._timelineValue = ++_graphicsTimelineValue;
+		_meshUploader.submit(_graphicsTimelineValue);
+		_bindless.submit(_graphicsTimelineValue);
+		VkSemaphoreSubmitInfo signalInfos[] = {
+			VkInit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _graphicsTimeline, _graphicsTimelineValue),
+			VkInit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _blitTimeline, ++_blitTimelineValue)
+		};
+
+		std::span<VkSemaphoreSubmitInfo> waitInfos;
+		if (computeWait) {
+			waitInfos = std::span(&*computeWait, 1);
+		}
+
+		VkSubmitInfo2 submit = VkInit::submit_info(&cmdinfo, signalInfos, waitInfos);
+
+		{
+			GEARHEAD_PROFILE_SCOPE("Submit");
+			GEARHEAD_VKSUCCESS_CHECK(vkQueueSubmit2(_graphicsQueue, 1, &submit, VK_NULL_HANDLE));
+		}
+
+		_frameNumber++;
+	}
+
+	bool VkHeadlessWindow::ReadbackFrame(std::vector<uint8_t>& outPixels)
+	{
+		if (_frameNumber == 0) {
+			GEARHEAD_CORE_WARN("ReadbackFrame called before any frame was drawn");
+			return false;
+		}
+
+		// R16G16B16A16_SFLOAT, 8 bytes per texel
+		constexpr size_t texelSize = 8;
+		size_t frameSize = size_t(_drawExtent.width) * _drawExtent.height * texelSize;
+
+		if (frameSize > _readbackSize) {
+			if (_readbackBuffer._buffer != VK_NULL_HANDLE) {
+				VkUtil::destroy_buffer(_allocator, _readbackBuffer);
+			}
+			_readbackBuffer = VkUtil::create_buffer(_allocator, frameSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+			_readbackSize = frameSize;
+		}
+
+		// queue order puts this behind the last frame, the barrier inside waits for it on the gpu
+		ImmediateSubmit([&](VkCommandBuffer cmd) {
+			VkUtil::transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+			VkUtil::copy_image_to_buffer(cmd, _drawImage.image, _readbackBuffer._buffer, _drawExtent);
+
+			//make the copy visible to the host
+			VkMemoryBarrier2 hostBarrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+			hostBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+			hostBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			hostBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+			hostBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+			VkDependencyInfo depInfo{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+			depInfo.memoryBarrierCount = 1;
+			depInfo.pMemoryBarriers = &hostBarrier;
+
+			vkCmdPipelineBarrier2(cmd, &depInfo);
+		});
+
+		GEARHEAD_VKSUCCESS_CHECK(vmaInvalidateAllocation(_allocator, _readbackBuffer._allocation, 0, frameSize));
+
+		outPixels.resize(frameSize);
+		memcpy(outPixels.data(), _readbackBuffer._info.pMappedData, frameSize);
+
+		return true;
+	}
+}
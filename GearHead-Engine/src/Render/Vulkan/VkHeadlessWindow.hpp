@@ -0,0 +1,43 @@
+#pragma once
+
+#include "VkWindow.hpp"
+
+namespace GearHead {
+
+	// Offscreen Vulkan backend. No GLFW window, surface or swapchain; every frame is
+	// rendered into the draw image and can be read back to host memory.
+	class GEARHEAD_API VkHeadlessWindow : public VkWindow {
+	public:
+
+		VkHeadlessWindow(const WindowProps& props);
+
+		virtual ~VkHeadlessWindow();
+
+		void OnUpdate() override;
+
+		void DrawFrame() override;
+
+		int ShouldClose() override { return mData.props.HeadlessFrames == 0 || _frameNumber < (int)mData.props.HeadlessFrames; }
+
+		// nothing is presented, so there is no vblank to sync to
+		void SetVSync(bool enabled) override { mData.vsync = enabled; }
+
+		// Copies the last finished frame into outPixels as tightly packed rows of the draw image format
+		bool ReadbackFrame(std::vector<uint8_t>& outPixels);
+
+		VkFormat GetReadbackFormat() const { return _drawImage.imageFormat; }
+		VkExtent2D GetReadbackExtent() const { return _drawExtent; }
+
+	protected:
+		void Init(const WindowProps& props) override;
+
+	private:
+		AllocatedBuffer _readbackBuffer{};
+		size_t _readbackSize{ 0 };
+
+		//frame time stats, reported on shutdown for benchmarks
+		double _totalFrameMs{ 0.0 };
+		double _minFrameMs{ std::numeric_limits<double>::max() };
+		double _maxFrameMs{ 0.0 };
+	};
+}
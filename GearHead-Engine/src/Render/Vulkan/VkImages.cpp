@@ -16,7 +16,10 @@ namespace VkUtil {
 		imageBarrier.oldLayout = currentLayout;
 		imageBarrier.newLayout = newLayout;
 
-		VkImageAspectFlags aspectMask = (newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+		auto isDepth = [](VkImageLayout layout) {
+			return layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+		};
+		VkImageAspectFlags aspectMask = (isDepth(newLayout) || isDepth(currentLayout)) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
 		imageBarrier.subresourceRange = VkInit::image_subresource_range(aspectMask);
 		imageBarrier.image = image;
 
@@ -67,5 +70,31 @@ namespace VkUtil {
 		vkCmdBlitImage2(cmd, &blitInfo);
 	}
 
+	void copy_image_to_buffer(VkCommandBuffer cmd, VkImage source, VkBuffer destination, VkExtent2D srcSize)
+	{
+		VkBufferImageCopy2 copyRegion{ .sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2, .pNext = nullptr };
+
+		//tightly packed rows
+		copyRegion.bufferOffset = 0;
+		copyRegion.bufferRowLength = 0;
+		copyRegion.bufferImageHeight = 0;
+
+		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegion.imageSubresource.baseArrayLayer = 0;
+		copyRegion.imageSubresource.layerCount = 1;
+		copyRegion.imageSubresource.mipLevel = 0;
+
+		copyRegion.imageExtent = { srcSize.width, srcSize.height, 1 };
+
+		VkCopyImageToBufferInfo2 copyInfo{ .sType = VK_STRUCTURE_TYPE_COPY_IMAGE_TO_BUFFER_INFO_2, .pNext = nullptr };
+		copyInfo.srcImage = source;
+		copyInfo.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		copyInfo.dstBuffer = destination;
+		copyInfo.regionCount = 1;
+		copyInfo.pRegions = &copyRegion;
+
+		vkCmdCopyImageToBuffer2(cmd, &copyInfo);
+	}
+
 
 }
@@ -68,7 +68,7 @@ namespace VkInit {
 		return semCreateInfo;
 	}
 
-	VkSemaphoreSubmitInfo semaphore_submit_info(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore)
+	VkSemaphoreSubmitInfo semaphore_submit_info(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore, uint64_t value)
 	{
 		VkSemaphoreSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
@@ -76,11 +76,23 @@ namespace VkInit {
 		submitInfo.semaphore = semaphore;
 		submitInfo.stageMask = stageMask;
 		submitInfo.deviceIndex = 0;
-		submitInfo.value = 1;
+		//ignored for binary semaphores
+		submitInfo.value = value;
 
 		return submitInfo;
 	}
 
+	VkSemaphoreTypeCreateInfo semaphore_type_create_info(VkSemaphoreType type, uint64_t initialValue)
+	{
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.pNext = nullptr;
+		typeInfo.semaphoreType = type;
+		typeInfo.initialValue = initialValue;
+
+		return typeInfo;
+	}
+
 	VkCommandBufferSubmitInfo command_buffer_submit_info(VkCommandBuffer cmd)
 	{
 		VkCommandBufferSubmitInfo info{};
@@ -111,6 +123,25 @@ namespace VkInit {
 		return info;
 	}
 
+	VkSubmitInfo2 submit_info(VkCommandBufferSubmitInfo* cmd, std::span<VkSemaphoreSubmitInfo> signalSemaphoreInfos,
+		std::span<VkSemaphoreSubmitInfo> waitSemaphoreInfos)
+	{
+		VkSubmitInfo2 info = {};
+		info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+		info.pNext = nullptr;
+
+		info.waitSemaphoreInfoCount = (uint32_t)waitSemaphoreInfos.size();
+		info.pWaitSemaphoreInfos = waitSemaphoreInfos.data();
+
+		info.signalSemaphoreInfoCount = (uint32_t)signalSemaphoreInfos.size();
+		info.pSignalSemaphoreInfos = signalSemaphoreInfos.data();
+
+		info.commandBufferInfoCount = 1;
+		info.pCommandBufferInfos = cmd;
+
+		return info;
+	}
+
 	VkImageCreateInfo image_create_info(VkFormat format, VkImageUsageFlags usageFlags, VkExtent3D extent)
 	{
 		VkImageCreateInfo info = {};
@@ -152,6 +183,23 @@ namespace VkInit {
 		return colorAttachment;
 	}
 
+	VkRenderingAttachmentInfo depth_attachment_info(VkImageView view, VkImageLayout layout)
+	{
+		VkRenderingAttachmentInfo depthAttachment{};
+		depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		depthAttachment.pNext = nullptr;
+
+		depthAttachment.imageView = view;
+		depthAttachment.imageLayout = layout;
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		//kept for the depth pyramid the next frame's occlusion culling reads
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		//reverse z, 0 is the far plane
+		depthAttachment.clearValue.depthStencil.depth = 0.f;
+
+		return depthAttachment;
+	}
+
 	VkRenderingInfo rendering_info(VkExtent2D renderExtent, VkRenderingAttachmentInfo* colorAttachment, VkRenderingAttachmentInfo* depthAttachment)
 	{
 		VkRenderingInfo renderInfo{};
@@ -187,5 +235,32 @@ namespace VkInit {
 		return info;
 	}
 
+	VkPipelineShaderStageCreateInfo pipeline_shader_stage_create_info(VkShaderStageFlagBits stage, VkShaderModule shaderModule, const char* entry)
+	{
+		VkPipelineShaderStageCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		info.pNext = nullptr;
+
+		info.stage = stage;
+		info.module = shaderModule;
+		info.pName = entry;
+
+		return info;
+	}
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info()
+	{
+		VkPipelineLayoutCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		info.pNext = nullptr;
+
+		//empty defaults
+		info.flags = 0;
+		info.setLayoutCount = 0;
+		info.pSetLayouts = nullptr;
+		info.pushConstantRangeCount = 0;
+		info.pPushConstantRanges = nullptr;
 
+		return info;
+	}
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "VkTypes.hpp"
+#include <span>
 
 namespace VkInit { //used for abstraction, i guess
 	VkCommandPoolCreateInfo command_pool_create_info(
@@ -22,7 +23,9 @@ namespace VkInit { //used for abstraction, i guess
 
 	VkCommandBufferSubmitInfo command_buffer_submit_info(VkCommandBuffer cmd);
 	
-	VkSemaphoreSubmitInfo semaphore_submit_info(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore);
+	VkSemaphoreSubmitInfo semaphore_submit_info(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore, uint64_t value = 1);
+
+	VkSemaphoreTypeCreateInfo semaphore_type_create_info(VkSemaphoreType type, uint64_t initialValue = 0);
 
 	VkSemaphoreCreateInfo semaphore_create_info(VkSemaphoreCreateFlags flags);
 
@@ -33,6 +36,11 @@ namespace VkInit { //used for abstraction, i guess
 		VkSemaphoreSubmitInfo* signalSemaphoreInfo,
 		VkSemaphoreSubmitInfo* waitSemaphoreInfo);
 
+	VkSubmitInfo2 submit_info(
+		VkCommandBufferSubmitInfo* cmd, 
+		std::span<VkSemaphoreSubmitInfo> signalSemaphoreInfos,
+		std::span<VkSemaphoreSubmitInfo> waitSemaphoreInfos);
+
 	VkImageViewCreateInfo imageview_create_info(
 		VkFormat format, 
 		VkImage image, 
@@ -48,8 +56,19 @@ namespace VkInit { //used for abstraction, i guess
 		VkClearValue* clear, 
 		VkImageLayout layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
+	VkRenderingAttachmentInfo depth_attachment_info(
+		VkImageView view, 
+		VkImageLayout layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
 	VkRenderingInfo rendering_info(
 		VkExtent2D renderExtent, 
 		VkRenderingAttachmentInfo* colorAttachment,
 		VkRenderingAttachmentInfo* depthAttachment);
+
+	VkPipelineShaderStageCreateInfo pipeline_shader_stage_create_info(
+		VkShaderStageFlagBits stage, 
+		VkShaderModule shaderModule, 
+		const char* entry = "main");
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info();
 }
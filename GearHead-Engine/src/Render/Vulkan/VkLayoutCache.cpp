@@ -0,0 +1,124 @@
+#include "VkLayoutCache.hpp"
+#include "VkInit.hpp"
+#include "Core/Core.hpp"
+
+namespace GearHead {
+
+	void LayoutCache::init(VkDevice device)
+	{
+		_device = device;
+	}
+
+	void LayoutCache::destroy()
+	{
+		for (auto& [key, layout] : _pipelineLayouts) {
+			vkDestroyPipelineLayout(_device, layout.pipelineLayout, nullptr);
+		}
+		for (auto& [key, layout] : _descriptorLayouts) {
+			vkDestroyDescriptorSetLayout(_device, layout, nullptr);
+		}
+		_pipelineLayouts.clear();
+		_descriptorLayouts.clear();
+		_reservedSets.clear();
+	}
+
+	void LayoutCache::reserve_set(uint32_t set, VkDescriptorSetLayout layout, std::span<const VkDescriptorType> bindingTypes)
+	{
+		_reservedSets[set] = { layout, std::vector<VkDescriptorType>(bindingTypes.begin(), bindingTypes.end()) };
+	}
+
+	VkDescriptorSetLayout LayoutCache::descriptor_layout(const DescriptorLayoutBuilder& builder, VkDescriptorSetLayoutCreateFlags flags)
+	{
+		//the order bindings were added in doesn't change the layout
+		DescriptorLayoutBuilder sorted = builder;
+		std::sort(sorted.bindings.begin(), sorted.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+			return a.binding < b.binding;
+			});
+
+		std::vector<uint32_t> key = { flags };
+		for (const VkDescriptorSetLayoutBinding& binding : sorted.bindings) {
+			key.insert(key.end(), { binding.binding, (uint32_t)binding.descriptorType, binding.descriptorCount, binding.stageFlags });
+		}
+
+		auto it = _descriptorLayouts.find(key);
+		if (it != _descriptorLayouts.end())
+			return it->second;
+
+		VkDescriptorSetLayout layout = sorted.build(_device, 0, nullptr, flags);
+		_descriptorLayouts.emplace(std::move(key), layout);
+		return layout;
+	}
+
+	const ShaderLayout* LayoutCache::pipeline_layout(std::span<const ShaderReflection* const> shaders, uint32_t minPushConstantSize)
+	{
+		ShaderLayout layout;
+		layout.pushConstantSize = minPushConstantSize;
+
+		uint32_t setCount = 0;
+		VkShaderStageFlags allStages = 0;
+		for (const ShaderReflection* shader : shaders) {
+			allStages |= shader->stage;
+			if (shader->pushConstantSize > 0) {
+				layout.pushConstantStages |= shader->stage;
+				layout.pushConstantSize = std::max(layout.pushConstantSize, shader->pushConstantSize);
+			}
+			for (const ShaderBinding& binding : shader->bindings) {
+				setCount = std::max(setCount, binding.set + 1);
+			}
+		}
+
+		//engine pushed data nobody reads still needs a range to land in
+		if (layout.pushConstantSize > 0 && layout.pushConstantStages == 0) {
+			layout.pushConstantStages = allStages;
+		}
+
+		for (uint32_t set = 0; set < setCount; set++) {
+			auto reserved = _reservedSets.find(set);
+			if (reserved != _reservedSets.end()) {
+				for (const ShaderReflection* shader : shaders) {
+					for (const ShaderBinding& binding : shader->bindings) {
+						const std::vector<VkDescriptorType>& types = reserved->second.bindingTypes;
+						if (binding.set == set && (binding.binding >= types.size() || types[binding.binding] != binding.type)) {
+							GEARHEAD_CORE_ERROR("Set {0} binding {1} doesn't match the reserved layout for that set", set, binding.binding);
+							return nullptr;
+						}
+					}
+				}
+				layout.setLayouts.push_back(reserved->second.layout);
+				continue;
+			}
+
+			DescriptorLayoutBuilder builder;
+			for (const ShaderReflection* shader : shaders) {
+				builder.add_bindings(*shader, set);
+			}
+			layout.setLayouts.push_back(descriptor_layout(builder));
+		}
+
+		//set layouts are already deduplicated, so their handles identify them
+		std::vector<uint64_t> key = { layout.pushConstantSize, layout.pushConstantStages };
+		for (VkDescriptorSetLayout setLayout : layout.setLayouts) {
+			key.push_back((uint64_t)setLayout);
+		}
+
+		auto it = _pipelineLayouts.find(key);
+		if (it != _pipelineLayouts.end())
+			return &it->second;
+
+		VkPushConstantRange pushConstant{};
+		pushConstant.offset = 0;
+		pushConstant.size = layout.pushConstantSize;
+		pushConstant.stageFlags = layout.pushConstantStages;
+
+		VkPipelineLayoutCreateInfo info = VkInit::pipeline_layout_create_info();
+		info.setLayoutCount = (uint32_t)layout.setLayouts.size();
+		info.pSetLayouts = layout.setLayouts.data();
+		info.pushConstantRangeCount = layout.pushConstantSize > 0 ? 1 : 0;
+		info.pPushConstantRanges = &pushConstant;
+
+		GEARHEAD_VKSUCCESS_CHECK(vkCreatePipelineLayout(_device, &info, nullptr, &layout.pipelineLayout));
+
+		auto inserted = _pipelineLayouts.emplace(std::move(key), std::move(layout));
+		return &inserted.first->second;
+	}
+}
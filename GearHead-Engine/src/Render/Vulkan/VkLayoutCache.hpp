@@ -0,0 +1,53 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkDescriptors.hpp"
+#include "VkShaderRegistry.hpp"
+#include "ghpch.hpp"
+
+namespace GearHead {
+
+	// A pipeline layout made from reflected shaders, plus what a caller needs to bind and push against it
+	struct ShaderLayout {
+		VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
+		//indexed by set, sets no shader uses in between get an empty layout
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		uint32_t pushConstantSize{ 0 };
+		VkShaderStageFlags pushConstantStages{ 0 };
+	};
+
+	// Owns every descriptor set and pipeline layout, deduplicated by content. Layouts with the same
+	// bindings come back as the same handle, so sets made for one stay compatible with the other.
+	class LayoutCache {
+	public:
+		void init(VkDevice device);
+		void destroy();
+
+		//shaders using this set get the given layout instead of a reflected one, as long as every binding
+		//they declare in it has the type the caller lists for that binding number
+		void reserve_set(uint32_t set, VkDescriptorSetLayout layout, std::span<const VkDescriptorType> bindingTypes);
+
+		VkDescriptorSetLayout descriptor_layout(const DescriptorLayoutBuilder& builder, VkDescriptorSetLayoutCreateFlags flags = 0);
+
+		//bindings are merged per set across the shaders, push constants become one range covering every
+		//stage that reads them. minPushConstantSize is for data the engine pushes whether a shader reads it or not.
+		//nullptr when a shader doesn't fit a reserved set
+		const ShaderLayout* pipeline_layout(std::span<const ShaderReflection* const> shaders, uint32_t minPushConstantSize = 0);
+
+		size_t descriptor_layout_count() const { return _descriptorLayouts.size(); }
+		size_t pipeline_layout_count() const { return _pipelineLayouts.size(); }
+
+	private:
+		struct ReservedSet {
+			VkDescriptorSetLayout layout{ VK_NULL_HANDLE };
+			std::vector<VkDescriptorType> bindingTypes;
+		};
+
+		VkDevice _device{ VK_NULL_HANDLE };
+		std::map<uint32_t, ReservedSet> _reservedSets;
+
+		//keys are the create info flattened into words, exact rather than hashed
+		std::map<std::vector<uint32_t>, VkDescriptorSetLayout> _descriptorLayouts;
+		std::map<std::vector<uint64_t>, ShaderLayout> _pipelineLayouts;
+	};
+}
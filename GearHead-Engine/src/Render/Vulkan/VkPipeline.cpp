@@ -1,46 +1,24 @@
 #include "VkPipeline.hpp"
 #include "ghpch.hpp"
+#include "Core/MappedFile.hpp"
 
 
 namespace VkUtil
 {
 	bool VkUtil::load_shader_module(const char* filePath, VkDevice device, VkShaderModule* outShaderModule)
 	{
-		// open the file. With cursor at the end
-		std::ifstream file(filePath, std::ios::ate | std::ios::binary);
-
-		if (!file.is_open()) {
+		//mapped rather than read, the driver copies the code out of the mapping itself
+		GearHead::MappedFile file;
+		if (!file.Open(filePath) || file.Size() == 0 || file.Size() % sizeof(uint32_t) != 0) {
 			return false;
 		}
 
-		// find what the size of the file is by looking up the location of the cursor
-		// because the cursor is at the end, it gives the size directly in bytes
-		size_t fileSize = (size_t)file.tellg();
-
-		// spirv expects the buffer to be on uint32, so make sure to reserve a int
-		// vector big enough for the entire file
-		std::vector<uint32_t> buffer(fileSize / sizeof(uint32_t));
-
-		// put file cursor at beginning
-		file.seekg(0);
-
-		// load the entire file into the buffer
-		file.read((char*)buffer.data(), fileSize);
-
-		// now that the file is loaded into the buffer, we can close it
-		file.close();
-
-		// create a new shader module, using the buffer we loaded
 		VkShaderModuleCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 		createInfo.pNext = nullptr;
+		createInfo.codeSize = file.Size();
+		createInfo.pCode = (const uint32_t*)file.Data();
 
-		// codeSize has to be in bytes, so multply the ints in the buffer by size of
-		// int to know the real size of the buffer
-		createInfo.codeSize = buffer.size() * sizeof(uint32_t);
-		createInfo.pCode = buffer.data();
-
-		// check that the creation goes well.
 		VkShaderModule shaderModule;
 		if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
 			return false;
@@ -49,3 +27,202 @@ namespace VkUtil
 		return true;
 	}
 }
+
+namespace GearHead
+{
+	void PipelineBuilder::clear()
+	{
+		// clear all of the structs back to 0 with their correct stype
+		_inputAssembly = { .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+		_rasterizer = { .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+		_colorBlendAttachment = {};
+		_multisampling = { .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+		_pipelineLayout = VK_NULL_HANDLE;
+		_depthStencil = { .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+		_renderInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO };
+		_colorAttachmentFormat = VK_FORMAT_UNDEFINED;
+
+		_shaderStages.clear();
+		_vertexInput = {};
+	}
+
+	VkPipeline PipelineBuilder::build_pipeline(VkDevice device, VkPipelineCache cache)
+	{
+		// viewport and scissor are dynamic, only the counts go in here
+		VkPipelineViewportStateCreateInfo viewportState = {};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.pNext = nullptr;
+
+		viewportState.viewportCount = 1;
+		viewportState.scissorCount = 1;
+
+		// no transparent objects yet, one attachment without logic ops
+		VkPipelineColorBlendStateCreateInfo colorBlending = {};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.pNext = nullptr;
+
+		colorBlending.logicOpEnable = VK_FALSE;
+		colorBlending.logicOp = VK_LOGIC_OP_COPY;
+		colorBlending.attachmentCount = 1;
+		colorBlending.pAttachments = &_colorBlendAttachment;
+
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+		vertexInputInfo.vertexBindingDescriptionCount = (uint32_t)_vertexInput.bindings.size();
+		vertexInputInfo.pVertexBindingDescriptions = _vertexInput.bindings.data();
+		vertexInputInfo.vertexAttributeDescriptionCount = (uint32_t)_vertexInput.attributes.size();
+		vertexInputInfo.pVertexAttributeDescriptions = _vertexInput.attributes.data();
+
+		VkDynamicState state[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+		VkPipelineDynamicStateCreateInfo dynamicInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+		dynamicInfo.pDynamicStates = &state[0];
+		dynamicInfo.dynamicStateCount = 2;
+
+		// the builder may have been copied since set_color_attachment_format
+		if (_renderInfo.colorAttachmentCount > 0) {
+			_renderInfo.pColorAttachmentFormats = &_colorAttachmentFormat;
+		}
+
+		// dynamic rendering, the attachment formats go through pNext instead of a render pass
+		VkGraphicsPipelineCreateInfo pipelineInfo = { .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+		pipelineInfo.pNext = &_renderInfo;
+
+		pipelineInfo.stageCount = (uint32_t)_shaderStages.size();
+		pipelineInfo.pStages = _shaderStages.data();
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &_inputAssembly;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &_rasterizer;
+		pipelineInfo.pMultisampleState = &_multisampling;
+		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.pDepthStencilState = &_depthStencil;
+		pipelineInfo.pDynamicState = &dynamicInfo;
+		pipelineInfo.layout = _pipelineLayout;
+
+		VkPipeline newPipeline;
+		if (vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS) {
+			GEARHEAD_CORE_ERROR("Failed to create graphics pipeline");
+			return VK_NULL_HANDLE;
+		}
+		return newPipeline;
+	}
+
+	void PipelineBuilder::set_shaders(VkShaderModule vertexShader, VkShaderModule fragmentShader)
+	{
+		_shaderStages.clear();
+
+		_shaderStages.push_back(VkInit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, vertexShader));
+		_shaderStages.push_back(VkInit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader));
+	}
+
+	void PipelineBuilder::set_vertex_input(const VertexInputDescription& description)
+	{
+		_vertexInput = description;
+	}
+
+	void PipelineBuilder::set_input_topology(VkPrimitiveTopology topology)
+	{
+		_inputAssembly.topology = topology;
+		// only used for triangle/line strips
+		_inputAssembly.primitiveRestartEnable = VK_FALSE;
+	}
+
+	void PipelineBuilder::set_polygon_mode(VkPolygonMode mode)
+	{
+		_rasterizer.polygonMode = mode;
+		_rasterizer.lineWidth = 1.f;
+	}
+
+	void PipelineBuilder::set_cull_mode(VkCullModeFlags cullMode, VkFrontFace frontFace)
+	{
+		_rasterizer.cullMode = cullMode;
+		_rasterizer.frontFace = frontFace;
+	}
+
+	void PipelineBuilder::set_multisampling_none()
+	{
+		_multisampling.sampleShadingEnable = VK_FALSE;
+		// 1 sample per pixel
+		_multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		_multisampling.minSampleShading = 1.0f;
+		_multisampling.pSampleMask = nullptr;
+		_multisampling.alphaToCoverageEnable = VK_FALSE;
+		_multisampling.alphaToOneEnable = VK_FALSE;
+	}
+
+	void PipelineBuilder::set_layout(VkPipelineLayout layout)
+	{
+		_pipelineLayout = layout;
+	}
+
+	void PipelineBuilder::disable_blending()
+	{
+		_colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		_colorBlendAttachment.blendEnable = VK_FALSE;
+	}
+
+	void PipelineBuilder::enable_blending_additive()
+	{
+		// outColor = src.rgb * src.a + dst.rgb
+		_colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		_colorBlendAttachment.blendEnable = VK_TRUE;
+		_colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		_colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		_colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+		_colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		_colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		_colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	}
+
+	void PipelineBuilder::enable_blending_alphablend()
+	{
+		// outColor = src.rgb * src.a + dst.rgb * (1 - src.a)
+		_colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		_colorBlendAttachment.blendEnable = VK_TRUE;
+		_colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		_colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		_colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+		_colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		_colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		_colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	}
+
+	void PipelineBuilder::set_color_attachment_format(VkFormat format)
+	{
+		_colorAttachmentFormat = format;
+		// connect the format to the renderInfo structure
+		_renderInfo.colorAttachmentCount = 1;
+		_renderInfo.pColorAttachmentFormats = &_colorAttachmentFormat;
+	}
+
+	void PipelineBuilder::set_depth_format(VkFormat format)
+	{
+		_renderInfo.depthAttachmentFormat = format;
+	}
+
+	void PipelineBuilder::disable_depthtest()
+	{
+		_depthStencil.depthTestEnable = VK_FALSE;
+		_depthStencil.depthWriteEnable = VK_FALSE;
+		_depthStencil.depthCompareOp = VK_COMPARE_OP_NEVER;
+		_depthStencil.depthBoundsTestEnable = VK_FALSE;
+		_depthStencil.stencilTestEnable = VK_FALSE;
+		_depthStencil.front = {};
+		_depthStencil.back = {};
+		_depthStencil.minDepthBounds = 0.f;
+		_depthStencil.maxDepthBounds = 1.f;
+	}
+
+	void PipelineBuilder::enable_depthtest(bool depthWriteEnable, VkCompareOp op)
+	{
+		_depthStencil.depthTestEnable = VK_TRUE;
+		_depthStencil.depthWriteEnable = depthWriteEnable;
+		_depthStencil.depthCompareOp = op;
+		_depthStencil.depthBoundsTestEnable = VK_FALSE;
+		_depthStencil.stencilTestEnable = VK_FALSE;
+		_depthStencil.front = {};
+		_depthStencil.back = {};
+		_depthStencil.minDepthBounds = 0.f;
+		_depthStencil.maxDepthBounds = 1.f;
+	}
+}
@@ -1,3 +1,4 @@
+#pragma once
 #include "VkTypes.hpp"
 #include "Core/Core.hpp"
 #include "ghpch.hpp"
@@ -9,3 +10,46 @@ namespace VkUtil {
 		VkShaderModule* outShaderModule);
 }
 
+namespace GearHead {
+
+	// Graphics pipelines for dynamic rendering, everything but the viewport and scissor is baked in.
+	// Call clear() to reuse the builder for another pipeline
+	class PipelineBuilder {
+	public:
+		std::vector<VkPipelineShaderStageCreateInfo> _shaderStages;
+		VertexInputDescription _vertexInput;
+
+		VkPipelineInputAssemblyStateCreateInfo _inputAssembly;
+		VkPipelineRasterizationStateCreateInfo _rasterizer;
+		VkPipelineColorBlendAttachmentState _colorBlendAttachment;
+		VkPipelineMultisampleStateCreateInfo _multisampling;
+		VkPipelineLayout _pipelineLayout;
+		VkPipelineDepthStencilStateCreateInfo _depthStencil;
+		VkPipelineRenderingCreateInfo _renderInfo;
+		VkFormat _colorAttachmentFormat;
+
+		PipelineBuilder() { clear(); }
+
+		void clear();
+
+		//VK_NULL_HANDLE on failure
+		VkPipeline build_pipeline(VkDevice device, VkPipelineCache cache = VK_NULL_HANDLE);
+
+		void set_shaders(VkShaderModule vertexShader, VkShaderModule fragmentShader);
+		void set_vertex_input(const VertexInputDescription& description);
+		void set_input_topology(VkPrimitiveTopology topology);
+		void set_polygon_mode(VkPolygonMode mode);
+		void set_cull_mode(VkCullModeFlags cullMode, VkFrontFace frontFace);
+		void set_multisampling_none();
+		void set_layout(VkPipelineLayout layout);
+
+		void disable_blending();
+		void enable_blending_additive();
+		void enable_blending_alphablend();
+
+		void set_color_attachment_format(VkFormat format);
+		void set_depth_format(VkFormat format);
+		void disable_depthtest();
+		void enable_depthtest(bool depthWriteEnable, VkCompareOp op);
+	};
+}
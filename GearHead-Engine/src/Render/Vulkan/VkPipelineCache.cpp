@@ -0,0 +1,173 @@
+#include "VkPipelineCache.hpp"
+#include "Core/Core.hpp"
+#include "Core/Hash.hpp"
+#include "Core/Profiler.hpp"
+#include "Core/ThreadPool.hpp"
+
+#include <filesystem>
+
+namespace GearHead {
+
+	void PipelineCache::init(VkDevice device, VkPhysicalDevice gpu, const std::string& path)
+	{
+		GEARHEAD_PROFILE_FUNCTION();
+
+		_device = device;
+		_path = path;
+		vkGetPhysicalDeviceProperties(gpu, &_properties);
+
+		std::vector<uint8_t> initialData;
+		if (!read_file(initialData)) {
+			initialData.clear();
+		}
+
+		VkPipelineCacheCreateInfo info{ .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+		info.initialDataSize = initialData.size();
+		info.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+		GEARHEAD_VKSUCCESS_CHECK(vkCreatePipelineCache(_device, &info, nullptr, &_cache));
+
+		_loadedSize = initialData.size();
+		_savedSize = _loadedSize;
+	}
+
+	void PipelineCache::destroy()
+	{
+		if (_pendingSave.valid()) {
+			_pendingSave.wait();
+		}
+
+		if (_cache != VK_NULL_HANDLE) {
+			vkDestroyPipelineCache(_device, _cache, nullptr);
+			_cache = VK_NULL_HANDLE;
+		}
+	}
+
+	bool PipelineCache::save()
+	{
+		if (_pendingSave.valid()) {
+			_pendingSave.wait();
+		}
+
+		std::vector<uint8_t> data = get_data();
+		if (data.empty() || data.size() == _savedSize)
+			return true;
+
+		_savedSize = data.size();
+		return write_file(data);
+	}
+
+	void PipelineCache::save_async()
+	{
+		//one write at a time, the next call picks up whatever this one missed
+		if (_pendingSave.valid() && !IsReady(_pendingSave))
+			return;
+
+		std::vector<uint8_t> data = get_data();
+		if (data.empty() || data.size() == _savedSize)
+			return;
+
+		_savedSize = data.size();
+		_pendingSave = ThreadPool::Get().Submit([this, data = std::move(data)]() { return write_file(data); });
+	}
+
+	bool PipelineCache::read_file(std::vector<uint8_t>& outData) const
+	{
+		std::ifstream file(_path, std::ios::binary | std::ios::ate);
+		if (!file.is_open()) {
+			GEARHEAD_CORE_INFO("No pipeline cache at {0}, starting cold", _path);
+			return false;
+		}
+
+		size_t fileSize = (size_t)file.tellg();
+		file.seekg(0);
+
+		PipelineCacheFileHeader header{};
+		if (fileSize < sizeof(header) || !file.read((char*)&header, sizeof(header))) {
+			GEARHEAD_CORE_WARN("Ignoring pipeline cache {0}: truncated header", _path);
+			return false;
+		}
+
+		if (header.magic != FILE_MAGIC || header.version != FILE_VERSION) {
+			GEARHEAD_CORE_WARN("Ignoring pipeline cache {0}: unknown format", _path);
+			return false;
+		}
+
+		//anything compiled for another gpu or driver is useless, and some drivers crash on it
+		if (header.vendorID != _properties.vendorID || header.deviceID != _properties.deviceID
+			|| header.driverVersion != _properties.driverVersion
+			|| memcmp(header.pipelineCacheUUID, _properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+			GEARHEAD_CORE_INFO("Ignoring pipeline cache {0}: written for another device or driver", _path);
+			return false;
+		}
+
+		if (header.dataSize != fileSize - sizeof(header)) {
+			GEARHEAD_CORE_WARN("Ignoring pipeline cache {0}: size mismatch", _path);
+			return false;
+		}
+
+		outData.resize(header.dataSize);
+		if (!file.read((char*)outData.data(), header.dataSize) || HashBytes(outData.data(), outData.size()) != header.dataHash) {
+			GEARHEAD_CORE_WARN("Ignoring pipeline cache {0}: corrupt data", _path);
+			return false;
+		}
+
+		return true;
+	}
+
+	std::vector<uint8_t> PipelineCache::get_data() const
+	{
+		size_t size = 0;
+		GEARHEAD_VKSUCCESS_CHECK(vkGetPipelineCacheData(_device, _cache, &size, nullptr));
+
+		std::vector<uint8_t> data(size);
+		if (size > 0) {
+			GEARHEAD_VKSUCCESS_CHECK(vkGetPipelineCacheData(_device, _cache, &size, data.data()));
+			data.resize(size);
+		}
+		return data;
+	}
+
+	bool PipelineCache::write_file(const std::vector<uint8_t>& data) const
+	{
+		GEARHEAD_PROFILE_FUNCTION();
+
+		PipelineCacheFileHeader header{};
+		header.magic = FILE_MAGIC;
+		header.version = FILE_VERSION;
+		header.vendorID = _properties.vendorID;
+		header.deviceID = _properties.deviceID;
+		header.driverVersion = _properties.driverVersion;
+		header.dataSize = (uint32_t)data.size();
+		header.dataHash = HashBytes(data.data(), data.size());
+		memcpy(header.pipelineCacheUUID, _properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+		//same as the mesh cache, never leave a half written file behind
+		std::string tempPath = _path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				GEARHEAD_CORE_ERROR("Failed to open {0} for writing", tempPath);
+				return false;
+			}
+
+			file.write((const char*)&header, sizeof(header));
+			file.write((const char*)data.data(), std::streamsize(data.size()));
+			if (!file.good()) {
+				GEARHEAD_CORE_ERROR("Failed writing {0}", tempPath);
+				return false;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, _path, ec);
+		if (ec) {
+			GEARHEAD_CORE_ERROR("Failed to move {0} into place: {1}", tempPath, ec.message());
+			std::filesystem::remove(tempPath, ec);
+			return false;
+		}
+
+		GEARHEAD_CORE_INFO("Wrote pipeline cache {0} ({1} bytes)", _path, data.size());
+		return true;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "ghpch.hpp"
+
+#include <future>
+
+namespace GearHead {
+
+	// file header in front of the driver's cache blob. The driver checks its own header too, this one
+	// also catches driver updates (same UUID, different driverVersion) and truncated or corrupt files
+	struct PipelineCacheFileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint32_t dataSize;
+		uint64_t dataHash;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	};
+
+	static_assert(sizeof(PipelineCacheFileHeader) == 48);
+
+	// VkPipelineCache backed by a file, loaded at startup and written back when it has grown
+	class PipelineCache {
+	public:
+		static constexpr uint32_t FILE_MAGIC = 0x43504847; // "GHPC"
+		static constexpr uint32_t FILE_VERSION = 1;
+
+		//starts empty when the file is missing or was written for another device or driver
+		void init(VkDevice device, VkPhysicalDevice gpu, const std::string& path);
+		//waits for a pending save, doesn't write
+		void destroy();
+
+		//no-op when nothing was added since the last save
+		bool save();
+		//snapshots the cache now, the file gets written on the thread pool
+		void save_async();
+
+		VkPipelineCache get() const { return _cache; }
+		//true when the cache was seeded from disk
+		bool is_warm() const { return _loadedSize > 0; }
+		size_t loaded_size() const { return _loadedSize; }
+
+	private:
+		bool read_file(std::vector<uint8_t>& outData) const;
+		std::vector<uint8_t> get_data() const;
+		bool write_file(const std::vector<uint8_t>& data) const;
+
+		VkDevice _device{ VK_NULL_HANDLE };
+		VkPipelineCache _cache{ VK_NULL_HANDLE };
+		VkPhysicalDeviceProperties _properties{};
+		std::string _path;
+
+		size_t _loadedSize{ 0 };
+		size_t _savedSize{ 0 };
+		std::future<bool> _pendingSave;
+	};
+}
@@ -0,0 +1,206 @@
+#include "VkPipelineCompiler.hpp"
+#include "Core/Core.hpp"
+#include "Core/Profiler.hpp"
+
+#include <filesystem>
+
+namespace GearHead {
+
+	void PipelineCompiler::init(VkDevice device, VkPipelineCache cache, ShaderRegistry& shaders, ThreadPool& pool)
+	{
+		_device = device;
+		_cache = cache;
+		_shaders = &shaders;
+		_pool = &pool;
+	}
+
+	void PipelineCompiler::destroy()
+	{
+		wait_all();
+
+		for (Entry& entry : _entries) {
+			if (entry.pipeline != VK_NULL_HANDLE) {
+				vkDestroyPipeline(_device, entry.pipeline, nullptr);
+			}
+		}
+		_entries.clear();
+
+		//only reached once the device is idle
+		for (VkPipeline pipeline : _retired) {
+			vkDestroyPipeline(_device, pipeline, nullptr);
+		}
+		_retired.clear();
+	}
+
+	PipelineId PipelineCompiler::compile_compute(const std::string& name, const std::string& shaderPath, VkPipelineLayout layout, PipelineId fallback)
+	{
+		VkDevice device = _device;
+		VkPipelineCache cache = _cache;
+		ShaderRegistry* shaders = _shaders;
+
+		auto build = [=]() -> VkPipeline {
+			GEARHEAD_PROFILE_SCOPE("Compile Pipeline");
+
+			std::string error;
+			const ShaderModule* shader = shaders->load(shaderPath, &error);
+			if (!shader) {
+				GEARHEAD_CORE_ERROR("Failed to load shader: {0}", error);
+				return VK_NULL_HANDLE;
+			}
+			if (shader->reflection.stage != VK_SHADER_STAGE_COMPUTE_BIT) {
+				GEARHEAD_CORE_ERROR("{0} is not a compute shader", shaderPath);
+				return VK_NULL_HANDLE;
+			}
+
+			VkComputePipelineCreateInfo info{ .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+			info.layout = layout;
+			info.stage = VkInit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, shader->module, shader->reflection.entryPoint.c_str());
+
+			//the cache is internally synchronized, every worker shares it
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			if (vkCreateComputePipelines(device, cache, 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
+				GEARHEAD_CORE_ERROR("Failed to create compute pipeline from {0}", shaderPath);
+				pipeline = VK_NULL_HANDLE;
+			}
+
+			//the module belongs to the registry
+			return pipeline;
+			};
+
+		return add_entry(name, { shaderPath }, std::move(build), fallback);
+	}
+
+	PipelineId PipelineCompiler::compile_graphics(const std::string& name, const PipelineBuilder& builder, const std::string& vertexPath, const std::string& fragmentPath, PipelineId fallback)
+	{
+		VkDevice device = _device;
+		VkPipelineCache cache = _cache;
+		ShaderRegistry* shaders = _shaders;
+
+		//the task gets its own copy, the caller's builder can be reused right away
+		auto build = [=, builder = builder]() mutable -> VkPipeline {
+			GEARHEAD_PROFILE_SCOPE("Compile Pipeline");
+
+			std::string error;
+			const ShaderModule* vertexShader = shaders->load(vertexPath, &error);
+			const ShaderModule* fragmentShader = vertexShader ? shaders->load(fragmentPath, &error) : nullptr;
+			if (!vertexShader || !fragmentShader) {
+				GEARHEAD_CORE_ERROR("Failed to load shader: {0}", error);
+				return VK_NULL_HANDLE;
+			}
+
+			builder.set_shaders(vertexShader->module, fragmentShader->module);
+			return builder.build_pipeline(device, cache);
+			};
+
+		return add_entry(name, { vertexPath, fragmentPath }, std::move(build), fallback);
+	}
+
+	PipelineId PipelineCompiler::add_entry(const std::string& name, std::vector<std::string> shaders, std::function<VkPipeline()>&& build, PipelineId fallback)
+	{
+		Entry& entry = _entries.emplace_back();
+		entry.name = name;
+		entry.shaders = std::move(shaders);
+		entry.build = std::move(build);
+		entry.fallback = fallback;
+
+		submit(entry);
+		return PipelineId(_entries.size() - 1);
+	}
+
+	void PipelineCompiler::submit(Entry& entry)
+	{
+		if (_pending == 0) {
+			_batchStart = std::chrono::high_resolution_clock::now();
+		}
+		_pending++;
+
+		entry.future = _pool->Submit(entry.build);
+	}
+
+	void PipelineCompiler::recompile_shader(const std::string& spvPath)
+	{
+		std::filesystem::path fileName = std::filesystem::path(spvPath).filename();
+
+		for (Entry& entry : _entries) {
+			bool usesShader = std::any_of(entry.shaders.begin(), entry.shaders.end(),
+				[&](const std::string& shader) { return std::filesystem::path(shader).filename() == fileName; });
+			if (!usesShader)
+				continue;
+
+			//one compile per entry at a time, this one picks the change up once it's done
+			if (entry.future.valid()) {
+				entry.dirty = true;
+				continue;
+			}
+
+			GEARHEAD_CORE_INFO("Rebuilding pipeline {0}", entry.name);
+			submit(entry);
+		}
+	}
+
+	void PipelineCompiler::finish(Entry& entry)
+	{
+		VkPipeline pipeline = entry.future.get();
+		_pending--;
+
+		if (pipeline == VK_NULL_HANDLE) {
+			GEARHEAD_CORE_ERROR("Pipeline {0} failed to compile, keeping {1}", entry.name,
+				entry.pipeline != VK_NULL_HANDLE ? "the previous one" : "its fallback");
+		}
+		else {
+			//swapped here, between frames. Frames already recorded keep using the old one
+			if (entry.pipeline != VK_NULL_HANDLE) {
+				_retired.push_back(entry.pipeline);
+			}
+			entry.pipeline = pipeline;
+		}
+
+		if (entry.dirty) {
+			entry.dirty = false;
+			submit(entry);
+		}
+
+		if (_pending == 0) {
+			_batchMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - _batchStart).count();
+		}
+	}
+
+	void PipelineCompiler::poll()
+	{
+		if (_pending == 0)
+			return;
+
+		for (Entry& entry : _entries) {
+			if (IsReady(entry.future)) {
+				finish(entry);
+			}
+		}
+	}
+
+	void PipelineCompiler::wait_all()
+	{
+		//finish() can resubmit a dirty entry, so keep going until nothing is left
+		while (_pending > 0) {
+			for (Entry& entry : _entries) {
+				if (entry.future.valid()) {
+					entry.future.wait();
+					finish(entry);
+				}
+			}
+		}
+	}
+
+	VkPipeline PipelineCompiler::get(PipelineId id) const
+	{
+		//fallbacks always point at earlier requests, so the chain can't loop
+		while (id < _entries.size()) {
+			const Entry& entry = _entries[id];
+			if (entry.pipeline != VK_NULL_HANDLE)
+				return entry.pipeline;
+			if (entry.fallback >= id)
+				break;
+			id = entry.fallback;
+		}
+		return VK_NULL_HANDLE;
+	}
+}
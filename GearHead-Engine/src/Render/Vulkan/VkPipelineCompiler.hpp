@@ -0,0 +1,74 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkPipeline.hpp"
+#include "VkShaderRegistry.hpp"
+#include "Core/ThreadPool.hpp"
+#include "ghpch.hpp"
+
+namespace GearHead {
+
+	using PipelineId = uint32_t;
+	constexpr PipelineId INVALID_PIPELINE = ~0u;
+
+	// Compiles pipelines on the thread pool through the shared pipeline cache. Requests return an id
+	// right away, get() hands out the pipeline once it's done and the fallback chain until then.
+	// Everything but the compilation itself happens on the render thread.
+	class PipelineCompiler {
+	public:
+		//shaders come from the registry, which has to outlive the compiler
+		void init(VkDevice device, VkPipelineCache cache, ShaderRegistry& shaders, ThreadPool& pool = ThreadPool::Get());
+		//waits for everything in flight, then destroys every pipeline it made
+		void destroy();
+
+		//layouts must outlive the compile, fallback is used until this one is ready
+		PipelineId compile_compute(const std::string& name, const std::string& shaderPath, VkPipelineLayout layout, PipelineId fallback = INVALID_PIPELINE);
+		PipelineId compile_graphics(const std::string& name, const PipelineBuilder& builder, const std::string& vertexPath, const std::string& fragmentPath, PipelineId fallback = INVALID_PIPELINE);
+
+		//rebuilds every pipeline made from this .spv (matched by file name), the old one stays in use until then
+		void recompile_shader(const std::string& spvPath);
+
+		//once per frame, picks up whatever finished without waiting on the rest
+		void poll();
+		void wait_all();
+
+		//VK_NULL_HANDLE when neither it nor anything in its fallback chain is ready
+		VkPipeline get(PipelineId id) const;
+		bool is_ready(PipelineId id) const { return id < _entries.size() && _entries[id].pipeline != VK_NULL_HANDLE; }
+
+		//pipelines replaced by a recompile, the caller destroys them once no frame in flight uses them
+		std::vector<VkPipeline> take_retired() { return std::exchange(_retired, {}); }
+
+		size_t pending() const { return _pending; }
+		//from the first request of the current batch until it drained
+		float batch_ms() const { return _batchMs; }
+
+	private:
+		struct Entry {
+			std::string name;
+			std::vector<std::string> shaders;
+			//kept around for recompiles
+			std::function<VkPipeline()> build;
+			std::future<VkPipeline> future;
+			VkPipeline pipeline{ VK_NULL_HANDLE };
+			PipelineId fallback{ INVALID_PIPELINE };
+			//a shader changed again while this one was compiling
+			bool dirty{ false };
+		};
+
+		PipelineId add_entry(const std::string& name, std::vector<std::string> shaders, std::function<VkPipeline()>&& build, PipelineId fallback);
+		void submit(Entry& entry);
+		void finish(Entry& entry);
+
+		VkDevice _device{ VK_NULL_HANDLE };
+		VkPipelineCache _cache{ VK_NULL_HANDLE };
+		ShaderRegistry* _shaders{ nullptr };
+		ThreadPool* _pool{ nullptr };
+
+		std::vector<Entry> _entries;
+		std::vector<VkPipeline> _retired;
+		size_t _pending{ 0 };
+		std::chrono::high_resolution_clock::time_point _batchStart{};
+		float _batchMs{ 0.f };
+	};
+}
@@ -0,0 +1,239 @@
+#include "VkProfiler.hpp"
+#include "Core/Core.hpp"
+
+namespace GearHead {
+
+	void GpuProfiler::init(VkDevice device, VkPhysicalDevice gpu, const std::vector<uint32_t>& queueFamilies, uint32_t frameSlots)
+	{
+		_device = device;
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(gpu, &properties);
+
+		_timestampPeriod = properties.limits.timestampPeriod;
+		//needed so compute and graphics timestamps can share a frame
+		_supported = properties.limits.timestampComputeAndGraphics;
+
+		if (!_supported) {
+			GEARHEAD_CORE_WARN("GPU timestamps not supported on all queues, GPU profiler disabled");
+			return;
+		}
+
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(gpu, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(gpu, &familyCount, families.data());
+
+		//scopes can start on one queue and end on another, so keep the bits every family agrees on
+		uint32_t validBits = 64;
+		for (uint32_t family : queueFamilies) {
+			validBits = std::min(validBits, families[family].timestampValidBits);
+		}
+
+		if (validBits == 0) {
+			_supported = false;
+			GEARHEAD_CORE_WARN("GPU timestamps not supported on all queues, GPU profiler disabled");
+			return;
+		}
+		_timestampMask = validBits == 64 ? ~0ull : (1ull << validBits) - 1;
+
+		VkQueryPoolCreateInfo queryPoolInfo{ .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		//one extra query at the end for clock calibration
+		_calibrationQuery = frameSlots * MAX_SCOPES * 2;
+		queryPoolInfo.queryCount = _calibrationQuery + 1;
+		GEARHEAD_VKSUCCESS_CHECK(vkCreateQueryPool(_device, &queryPoolInfo, nullptr, &_pool));
+
+		vkResetQueryPool(_device, _pool, 0, queryPoolInfo.queryCount);
+
+		_slots.resize(frameSlots);
+	}
+
+	void GpuProfiler::destroy()
+	{
+		if (_pool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(_device, _pool, nullptr);
+			_pool = VK_NULL_HANDLE;
+		}
+	}
+
+	void GpuProfiler::write_calibration_timestamp(VkCommandBuffer cmd)
+	{
+		if (!_supported)
+			return;
+
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, _pool, _calibrationQuery);
+	}
+
+	void GpuProfiler::calibrate(double cpuUs)
+	{
+		if (!_supported)
+			return;
+
+		uint64_t timestamp;
+		VkResult result = vkGetQueryPoolResults(_device, _pool, _calibrationQuery, 1, sizeof(timestamp), &timestamp,
+			sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result != VK_SUCCESS) {
+			GEARHEAD_CORE_WARN("GPU clock calibration failed, GPU trace won't line up with the CPU");
+			return;
+		}
+
+		timestamp &= _timestampMask;
+		_gpuToCpuUs = cpuUs - double(timestamp) * _timestampPeriod / 1000.0;
+		vkResetQueryPool(_device, _pool, _calibrationQuery, 1);
+	}
+
+	void GpuProfiler::resolve(uint32_t slot)
+	{
+		if (!_supported)
+			return;
+
+		Slot& s = _slots[slot];
+		if (!s.pending || s.scopeCount == 0)
+			return;
+
+		s.pending = false;
+
+		uint64_t timestamps[MAX_SCOPES * 2];
+		uint32_t firstQuery = slot * MAX_SCOPES * 2;
+		VkResult result = vkGetQueryPoolResults(_device, _pool, firstQuery, s.scopeCount * 2,
+			sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+		//a frame that got dropped mid way (e.g. out of date swapchain) never wrote all its queries
+		if (result != VK_SUCCESS)
+			return;
+
+		for (uint32_t i = 0; i < s.scopeCount * 2; i++) {
+			timestamps[i] &= _timestampMask;
+		}
+
+		uint64_t frameBegin = ~0ull;
+		for (uint32_t i = 0; i < s.scopeCount; i++) {
+			frameBegin = std::min(frameBegin, timestamps[i * 2]);
+		}
+
+		auto toMs = [&](uint64_t ticks) { return double(ticks) * _timestampPeriod / 1000000.0; };
+
+		_lastFrame.frameNumber = s.frameNumber;
+		_lastFrame.frameBeginUs = double(frameBegin) * _timestampPeriod / 1000.0 + _gpuToCpuUs;
+		_lastFrame.scopes.clear();
+		for (uint32_t i = 0; i < s.scopeCount; i++) {
+			uint64_t begin = timestamps[i * 2];
+			uint64_t end = std::max(begin, timestamps[i * 2 + 1]);
+			_lastFrame.scopes.push_back({ s.names[i], toMs(begin - frameBegin), toMs(end - begin) });
+		}
+
+		if (_capturing) {
+			_captured.push_back(_lastFrame);
+			if (_captured.size() > MAX_CAPTURED_FRAMES)
+				_captured.pop_front();
+		}
+	}
+
+	void GpuProfiler::begin_frame(uint32_t slot, uint64_t frameNumber)
+	{
+		if (!_supported)
+			return;
+
+		_currentSlot = slot;
+
+		Slot& s = _slots[slot];
+		//results of the last use were read in resolve, the range is free to reuse
+		vkResetQueryPool(_device, _pool, slot * MAX_SCOPES * 2, MAX_SCOPES * 2);
+
+		s.frameNumber = frameNumber;
+		s.scopeCount = 0;
+		s.pending = true;
+	}
+
+	uint32_t GpuProfiler::begin_scope(VkCommandBuffer cmd, const char* name)
+	{
+		if (!_supported)
+			return 0;
+
+		Slot& s = _slots[_currentSlot];
+		if (s.scopeCount >= MAX_SCOPES) {
+			GEARHEAD_CORE_WARN("GPU profiler out of scopes, dropping {0}", name);
+			return MAX_SCOPES;
+		}
+
+		uint32_t scope = s.scopeCount++;
+		s.names[scope] = name;
+
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, _pool, (_currentSlot * MAX_SCOPES + scope) * 2);
+		return scope;
+	}
+
+	void GpuProfiler::end_scope(VkCommandBuffer cmd, uint32_t scope)
+	{
+		if (!_supported || scope >= MAX_SCOPES)
+			return;
+
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _pool, (_currentSlot * MAX_SCOPES + scope) * 2 + 1);
+	}
+
+	double GpuProfiler::get_scope_ms(const char* name) const
+	{
+		for (const GpuScopeTiming& scope : _lastFrame.scopes) {
+			if (strcmp(scope.name, name) == 0)
+				return scope.durationMs;
+		}
+		return 0.0;
+	}
+
+	bool GpuProfiler::write_csv(const std::string& path) const
+	{
+		std::ofstream file(path);
+		if (!file.is_open()) {
+			GEARHEAD_CORE_ERROR("Failed to open {0} for the GPU profile", path);
+			return false;
+		}
+
+		file << "frame,scope,begin_ms,duration_ms\n";
+		for (const GpuFrameTimings& frame : _captured) {
+			for (const GpuScopeTiming& scope : frame.scopes) {
+				file << frame.frameNumber << ',' << scope.name << ',' << scope.beginMs << ',' << scope.durationMs << '\n';
+			}
+		}
+
+		GEARHEAD_CORE_INFO("Wrote {0} GPU frames to {1}", _captured.size(), path);
+		return true;
+	}
+
+	bool GpuProfiler::write_chrome_trace(const std::string& path) const
+	{
+		std::ofstream file(path);
+		if (!file.is_open()) {
+			GEARHEAD_CORE_ERROR("Failed to open {0} for the GPU trace", path);
+			return false;
+		}
+
+		// chrome://tracing / Perfetto "complete" events, times in microseconds
+		file << "{\"traceEvents\":[\n";
+		file << "{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":2,\"args\":{\"sort_index\":1}}";
+		append_chrome_events(file);
+		file << "\n]}\n";
+
+		GEARHEAD_CORE_INFO("Wrote {0} GPU frames to {1}", _captured.size(), path);
+		return true;
+	}
+
+	void GpuProfiler::append_chrome_events(std::ostream& out) const
+	{
+		//own process so it sits under the CPU threads instead of mixing with them
+		out << ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}";
+		out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":0,\"args\":{\"name\":\"Queues\"}}";
+
+		std::ios_base::fmtflags flags = out.flags();
+		out << std::fixed;
+		for (const GpuFrameTimings& frame : _captured) {
+			for (const GpuScopeTiming& scope : frame.scopes) {
+				out << ",\n{\"name\":\"" << scope.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":2,\"tid\":0"
+					<< ",\"ts\":" << (frame.frameBeginUs + scope.beginMs * 1000.0)
+					<< ",\"dur\":" << (scope.durationMs * 1000.0)
+					<< ",\"args\":{\"frame\":" << frame.frameNumber << "}}";
+			}
+		}
+		out.flags(flags);
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "ghpch.hpp"
+
+namespace GearHead {
+
+	struct GpuScopeTiming {
+		const char* name;
+		//relative to the first timestamp of the frame
+		double beginMs;
+		double durationMs;
+	};
+
+	struct GpuFrameTimings {
+		uint64_t frameNumber;
+		//microseconds on the CPU profiler clock once calibrated, raw gpu clock otherwise
+		double frameBeginUs;
+		std::vector<GpuScopeTiming> scopes;
+	};
+
+	// Timestamp query ring, one range of queries per frame in flight. Queries are reset from the host
+	// and resolved after the frame's timeline wait, so reading them never stalls.
+	class GpuProfiler {
+	public:
+		static constexpr uint32_t MAX_SCOPES = 32;
+		static constexpr size_t MAX_CAPTURED_FRAMES = 2000;
+
+		//queueFamilies are every family a scope can be written from
+		void init(VkDevice device, VkPhysicalDevice gpu, const std::vector<uint32_t>& queueFamilies, uint32_t frameSlots);
+		void destroy();
+
+		//maps gpu timestamps onto the CPU profiler clock. Record the timestamp, wait for it to execute,
+		//then hand calibrate the CPU time halfway between the submit and the end of the wait
+		void write_calibration_timestamp(VkCommandBuffer cmd);
+		void calibrate(double cpuUs);
+
+		//call once the slot's previous frame is known to be done
+		void resolve(uint32_t slot);
+		void begin_frame(uint32_t slot, uint64_t frameNumber);
+
+		//scopes may begin and end in different command buffers of the same frame, even on different queues
+		uint32_t begin_scope(VkCommandBuffer cmd, const char* name);
+		void end_scope(VkCommandBuffer cmd, uint32_t scope);
+
+		const GpuFrameTimings& get_last_frame() const { return _lastFrame; }
+		double get_scope_ms(const char* name) const;
+
+		void start_capture() { _captured.clear(); _capturing = true; }
+		void stop_capture() { _capturing = false; }
+		bool is_capturing() const { return _capturing; }
+		size_t get_captured_frames() const { return _captured.size(); }
+
+		bool write_csv(const std::string& path) const;
+		bool write_chrome_trace(const std::string& path) const;
+		//GPU track for a trace written by Profiler::WriteChromeTrace
+		void append_chrome_events(std::ostream& out) const;
+
+	private:
+		struct Slot {
+			uint64_t frameNumber{ 0 };
+			uint32_t scopeCount{ 0 };
+			const char* names[MAX_SCOPES];
+			bool pending{ false };
+		};
+
+		VkDevice _device{ VK_NULL_HANDLE };
+		VkQueryPool _pool{ VK_NULL_HANDLE };
+		double _timestampPeriod{ 1.0 };
+		//bits past timestampValidBits are undefined
+		uint64_t _timestampMask{ ~0ull };
+		uint32_t _calibrationQuery{ 0 };
+		double _gpuToCpuUs{ 0.0 };
+		bool _supported{ false };
+
+		std::vector<Slot> _slots;
+		uint32_t _currentSlot{ 0 };
+
+		GpuFrameTimings _lastFrame{};
+
+		bool _capturing{ false };
+		std::deque<GpuFrameTimings> _captured;
+	};
+}
@@ -0,0 +1,449 @@
+#include "VkShaderRegistry.hpp"
+#include "Core/Core.hpp"
+#include "Core/Hash.hpp"
+#include "Core/MappedFile.hpp"
+#include "Core/Profiler.hpp"
+
+namespace GearHead {
+
+	void ShaderRegistry::init(VkDevice device)
+	{
+		_device = device;
+	}
+
+	void ShaderRegistry::destroy()
+	{
+		std::lock_guard lock(_mutex);
+
+		for (auto& [hash, shader] : _modules) {
+			vkDestroyShaderModule(_device, shader->module, nullptr);
+		}
+		for (auto& shader : _shadowed) {
+			vkDestroyShaderModule(_device, shader->module, nullptr);
+		}
+		_modules.clear();
+		_shadowed.clear();
+		_paths.clear();
+	}
+
+	const ShaderModule* ShaderRegistry::load(const std::string& path, std::string* error)
+	{
+		std::error_code ec;
+		std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, ec);
+		uintmax_t fileSize = ec ? 0 : std::filesystem::file_size(path, ec);
+		if (ec) {
+			if (error) *error = "can't open " + path;
+			return nullptr;
+		}
+
+		{
+			std::lock_guard lock(_mutex);
+			auto it = _paths.find(path);
+			if (it != _paths.end() && it->second.writeTime == writeTime && it->second.size == fileSize)
+				return it->second.shader;
+		}
+
+		//mapping, hashing and reflecting happen outside the lock, only creating the module is serialized
+		GEARHEAD_PROFILE_SCOPE("Load Shader");
+
+		MappedFile file;
+		if (!file.Open(path)) {
+			if (error) *error = "can't open " + path;
+			return nullptr;
+		}
+
+		if (file.Size() == 0 || file.Size() % sizeof(uint32_t) != 0) {
+			if (error) *error = path + " is not a SPIR-V binary";
+			return nullptr;
+		}
+
+		//mappings are page aligned, so the words can be read in place
+		std::span<const uint32_t> code((const uint32_t*)file.Data(), file.Size() / sizeof(uint32_t));
+		uint64_t hash = HashBytes(file.Data(), file.Size());
+
+		ShaderReflection reflection;
+		std::string reflectError;
+		if (!VkUtil::reflect_shader(code, reflection, &reflectError)) {
+			if (error) *error = path + ": " + reflectError;
+			return nullptr;
+		}
+
+		std::lock_guard lock(_mutex);
+
+		const ShaderModule* shader = nullptr;
+		auto existing = _modules.find(hash);
+		if (existing != _modules.end() && existing->second->size == file.Size()) {
+			shader = existing->second.get();
+		}
+		else {
+			VkShaderModuleCreateInfo createInfo{ .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+			createInfo.codeSize = file.Size();
+			createInfo.pCode = code.data();
+
+			VkShaderModule module;
+			if (vkCreateShaderModule(_device, &createInfo, nullptr, &module) != VK_SUCCESS) {
+				if (error) *error = "vkCreateShaderModule failed for " + path;
+				return nullptr;
+			}
+
+			auto created = std::make_unique<ShaderModule>();
+			created->module = module;
+			created->hash = hash;
+			created->size = file.Size();
+			created->reflection = std::move(reflection);
+			shader = created.get();
+
+			//a different binary under the same hash, whoever holds the old one can keep using it
+			if (existing != _modules.end()) {
+				_shadowed.push_back(std::move(existing->second));
+			}
+			_modules[hash] = std::move(created);
+		}
+
+		_paths[path] = { writeTime, fileSize, shader };
+		return shader;
+	}
+
+	size_t ShaderRegistry::module_count() const
+	{
+		std::lock_guard lock(_mutex);
+		return _modules.size();
+	}
+}
+
+namespace VkUtil {
+
+	namespace {
+		//only the opcodes and enums the reflection below looks at, see the SPIR-V spec for the rest
+		constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+		enum SpvOp : uint32_t {
+			OpEntryPoint = 15,
+			OpExecutionMode = 16,
+			OpTypeBool = 20,
+			OpTypeInt = 21,
+			OpTypeFloat = 22,
+			OpTypeVector = 23,
+			OpTypeMatrix = 24,
+			OpTypeImage = 25,
+			OpTypeSampler = 26,
+			OpTypeSampledImage = 27,
+			OpTypeArray = 28,
+			OpTypeRuntimeArray = 29,
+			OpTypeStruct = 30,
+			OpTypePointer = 32,
+			OpConstant = 43,
+			OpVariable = 59,
+			OpDecorate = 71,
+			OpMemberDecorate = 72,
+			OpTypeAccelerationStructureKHR = 5341,
+		};
+
+		enum SpvDecoration : uint32_t {
+			DecorationBlock = 2,
+			DecorationBufferBlock = 3,
+			DecorationArrayStride = 6,
+			DecorationMatrixStride = 7,
+			DecorationBinding = 33,
+			DecorationDescriptorSet = 34,
+			DecorationOffset = 35,
+		};
+
+		enum SpvStorageClass : uint32_t {
+			StorageClassUniformConstant = 0,
+			StorageClassUniform = 2,
+			StorageClassPushConstant = 9,
+			StorageClassStorageBuffer = 12,
+			StorageClassPhysicalStorageBuffer = 5349,
+		};
+
+		constexpr uint32_t ExecutionModeLocalSize = 17;
+		constexpr uint32_t DimBuffer = 5;
+		constexpr uint32_t DimSubpassData = 6;
+
+		struct SpvId {
+			uint32_t op{ 0 };
+			//type operands, what they mean depends on op
+			std::vector<uint32_t> operands;
+
+			//decorations
+			uint32_t set{ ~0u };
+			uint32_t binding{ ~0u };
+			uint32_t arrayStride{ 0 };
+			bool block{ false };
+			bool bufferBlock{ false };
+			//struct members
+			std::vector<uint32_t> memberOffsets;
+			std::vector<uint32_t> memberMatrixStrides;
+		};
+
+		//operands a type declaration needs before anything below may read them
+		uint32_t type_operand_count(uint32_t op)
+		{
+			switch (op) {
+			case OpTypeImage: return 7;
+			case OpTypeInt:
+			case OpTypeVector:
+			case OpTypeMatrix:
+			case OpTypeArray:
+			case OpTypePointer: return 2;
+			case OpTypeFloat:
+			case OpTypeSampledImage:
+			case OpTypeRuntimeArray: return 1;
+			default: return 0;
+			}
+		}
+
+		VkShaderStageFlagBits execution_model_stage(uint32_t model)
+		{
+			switch (model) {
+			case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+			case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+			case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+			case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+			case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+			case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+			case 5364: return VK_SHADER_STAGE_TASK_BIT_EXT;
+			case 5365: return VK_SHADER_STAGE_MESH_BIT_EXT;
+			default: return VK_SHADER_STAGE_ALL;
+			}
+		}
+
+		//spec constant lengths count as 1, their value isn't known until the pipeline is made
+		uint32_t array_length(const std::vector<SpvId>& ids, const SpvId& array)
+		{
+			uint32_t lengthId = array.operands[1];
+			return lengthId < ids.size() && ids[lengthId].op == OpConstant ? ids[lengthId].operands[0] : 1;
+		}
+
+		//size of a type inside an explicitly laid out block, matrixStride comes from the member using it
+		uint32_t type_size(const std::vector<SpvId>& ids, uint32_t typeId, uint32_t matrixStride = 0)
+		{
+			if (typeId >= ids.size())
+				return 0;
+
+			const SpvId& type = ids[typeId];
+			switch (type.op) {
+			case OpTypeBool:
+				return 4;
+			case OpTypeInt:
+			case OpTypeFloat:
+				return type.operands[0] / 8;
+			case OpTypeVector:
+				return type.operands[1] * type_size(ids, type.operands[0]);
+			case OpTypeMatrix:
+				return type.operands[1] * (matrixStride ? matrixStride : type_size(ids, type.operands[0]));
+			case OpTypeArray: {
+				uint32_t count = array_length(ids, type);
+				uint32_t stride = type.arrayStride ? type.arrayStride : type_size(ids, type.operands[0], matrixStride);
+				return count * stride;
+			}
+			case OpTypePointer:
+				//buffer_reference members, a 64 bit device address
+				return type.operands[0] == StorageClassPhysicalStorageBuffer ? 8 : 0;
+			case OpTypeStruct: {
+				uint32_t size = 0;
+				for (size_t member = 0; member < type.operands.size(); member++) {
+					uint32_t offset = member < type.memberOffsets.size() ? type.memberOffsets[member] : size;
+					uint32_t stride = member < type.memberMatrixStrides.size() ? type.memberMatrixStrides[member] : 0;
+					size = std::max(size, offset + type_size(ids, type.operands[member], stride));
+				}
+				return size;
+			}
+			default:
+				//runtime arrays and opaque types take no space in a block
+				return 0;
+			}
+		}
+
+		VkDescriptorType descriptor_type(const std::vector<SpvId>& ids, uint32_t typeId, uint32_t storageClass)
+		{
+			const SpvId& type = ids[typeId];
+
+			if (storageClass == StorageClassStorageBuffer)
+				return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			if (storageClass == StorageClassUniform)
+				return type.bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+			switch (type.op) {
+			case OpTypeSampler:
+				return VK_DESCRIPTOR_TYPE_SAMPLER;
+			case OpTypeSampledImage:
+				return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			case OpTypeAccelerationStructureKHR:
+				return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+			case OpTypeImage: {
+				//sampled type, dim, depth, arrayed, ms, sampled, format
+				uint32_t dim = type.operands[1];
+				bool storage = type.operands[5] == 2;
+				if (dim == DimBuffer)
+					return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				if (dim == DimSubpassData)
+					return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			}
+			default:
+				return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+			}
+		}
+	}
+
+	bool reflect_shader(std::span<const uint32_t> code, GearHead::ShaderReflection& outReflection, std::string* error)
+	{
+		auto fail = [&](const char* reason) {
+			if (error) *error = reason;
+			return false;
+			};
+
+		if (code.size() < 5 || code[0] != SPIRV_MAGIC)
+			return fail("not a SPIR-V binary");
+
+		uint32_t bound = code[3];
+		if (bound == 0 || bound > (1u << 22))
+			return fail("id bound out of range");
+
+		std::vector<SpvId> ids(bound);
+		struct Variable {
+			uint32_t id;
+			uint32_t pointerType;
+			uint32_t storageClass;
+		};
+		std::vector<Variable> variables;
+		uint32_t entryId = ~0u;
+
+		outReflection = {};
+
+		for (size_t word = 5; word < code.size();) {
+			uint32_t op = code[word] & 0xffff;
+			uint32_t count = code[word] >> 16;
+			if (count == 0 || word + count > code.size())
+				return fail("truncated instruction");
+
+			const uint32_t* ops = &code[word + 1];
+			uint32_t opCount = count - 1;
+
+			auto valid_id = [&](uint32_t id) { return id < bound; };
+
+			switch (op) {
+			case OpEntryPoint:
+				//the first one wins, the engine compiles one entry point per file
+				if (entryId == ~0u && opCount >= 3) {
+					outReflection.stage = execution_model_stage(ops[0]);
+					entryId = ops[1];
+					outReflection.entryPoint = std::string((const char*)&ops[2], strnlen((const char*)&ops[2], (opCount - 2) * sizeof(uint32_t)));
+				}
+				break;
+			case OpExecutionMode:
+				if (opCount >= 5 && ops[0] == entryId && ops[1] == ExecutionModeLocalSize) {
+					outReflection.localSize = { ops[2], ops[3], ops[4] };
+				}
+				break;
+			case OpDecorate:
+				if (opCount >= 2 && valid_id(ops[0])) {
+					SpvId& target = ids[ops[0]];
+					switch (ops[1]) {
+					case DecorationBlock: target.block = true; break;
+					case DecorationBufferBlock: target.bufferBlock = true; break;
+					case DecorationArrayStride: if (opCount >= 3) target.arrayStride = ops[2]; break;
+					case DecorationBinding: if (opCount >= 3) target.binding = ops[2]; break;
+					case DecorationDescriptorSet: if (opCount >= 3) target.set = ops[2]; break;
+					}
+				}
+				break;
+			case OpMemberDecorate:
+				if (opCount >= 4 && valid_id(ops[0]) && (ops[2] == DecorationOffset || ops[2] == DecorationMatrixStride)) {
+					std::vector<uint32_t>& values = ops[2] == DecorationOffset ? ids[ops[0]].memberOffsets : ids[ops[0]].memberMatrixStrides;
+					if (values.size() <= ops[1]) {
+						values.resize(ops[1] + 1, 0);
+					}
+					values[ops[1]] = ops[3];
+				}
+				break;
+			case OpTypeBool:
+			case OpTypeInt:
+			case OpTypeFloat:
+			case OpTypeVector:
+			case OpTypeMatrix:
+			case OpTypeImage:
+			case OpTypeSampler:
+			case OpTypeSampledImage:
+			case OpTypeArray:
+			case OpTypeRuntimeArray:
+			case OpTypeStruct:
+			case OpTypePointer:
+			case OpTypeAccelerationStructureKHR:
+				if (opCount >= 1 + type_operand_count(op) && valid_id(ops[0])) {
+					ids[ops[0]].op = op;
+					ids[ops[0]].operands.assign(ops + 1, ops + opCount);
+				}
+				break;
+			case OpConstant:
+				//result type, result, value (the low word is enough for array lengths)
+				if (opCount >= 3 && valid_id(ops[1])) {
+					ids[ops[1]].op = op;
+					ids[ops[1]].operands = { ops[2] };
+				}
+				break;
+			case OpVariable:
+				if (opCount >= 3 && valid_id(ops[0]) && valid_id(ops[1])) {
+					variables.push_back({ ops[1], ops[0], ops[2] });
+				}
+				break;
+			}
+
+			word += count;
+		}
+
+		if (entryId == ~0u)
+			return fail("no entry point");
+
+		for (const Variable& variable : variables) {
+			const SpvId& pointer = ids[variable.pointerType];
+			if (pointer.op != OpTypePointer || pointer.operands.size() < 2 || pointer.operands[1] >= bound)
+				continue;
+
+			uint32_t typeId = pointer.operands[1];
+
+			if (variable.storageClass == StorageClassPushConstant) {
+				outReflection.pushConstantSize = std::max(outReflection.pushConstantSize, type_size(ids, typeId));
+				continue;
+			}
+
+			if (variable.storageClass != StorageClassUniformConstant && variable.storageClass != StorageClassUniform && variable.storageClass != StorageClassStorageBuffer)
+				continue;
+
+			const SpvId& decorations = ids[variable.id];
+			if (decorations.set == ~0u || decorations.binding == ~0u)
+				continue;
+
+			GearHead::ShaderBinding binding;
+			binding.set = decorations.set;
+			binding.binding = decorations.binding;
+
+			//arrays of descriptors
+			if (ids[typeId].op == OpTypeArray) {
+				binding.count = array_length(ids, ids[typeId]);
+				typeId = ids[typeId].operands[0];
+			}
+			else if (ids[typeId].op == OpTypeRuntimeArray) {
+				binding.count = 0;
+				typeId = ids[typeId].operands[0];
+			}
+
+			if (typeId >= bound)
+				return fail("type id out of range");
+
+			binding.type = descriptor_type(ids, typeId, variable.storageClass);
+			if (binding.type == VK_DESCRIPTOR_TYPE_MAX_ENUM)
+				return fail("unsupported descriptor type");
+
+			outReflection.bindings.push_back(binding);
+		}
+
+		std::sort(outReflection.bindings.begin(), outReflection.bindings.end(), [](const GearHead::ShaderBinding& a, const GearHead::ShaderBinding& b) {
+			return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+			});
+
+		return true;
+	}
+}
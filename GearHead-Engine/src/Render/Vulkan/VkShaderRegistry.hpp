@@ -0,0 +1,71 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "ghpch.hpp"
+
+#include <filesystem>
+#include <mutex>
+
+namespace GearHead {
+
+	struct ShaderBinding {
+		uint32_t set{ 0 };
+		uint32_t binding{ 0 };
+		VkDescriptorType type{ VK_DESCRIPTOR_TYPE_MAX_ENUM };
+		//0 for runtime sized arrays
+		uint32_t count{ 1 };
+	};
+
+	// What a pipeline layout has to provide for this shader, read straight from the SPIR-V
+	struct ShaderReflection {
+		VkShaderStageFlagBits stage{ VK_SHADER_STAGE_ALL };
+		std::string entryPoint;
+		//bytes up to the end of the last member, 0 when the shader has no push constant block
+		uint32_t pushConstantSize{ 0 };
+		std::vector<ShaderBinding> bindings;
+		//compute only
+		std::array<uint32_t, 3> localSize{ 1, 1, 1 };
+	};
+
+	struct ShaderModule {
+		VkShaderModule module{ VK_NULL_HANDLE };
+		uint64_t hash{ 0 };
+		size_t size{ 0 };
+		ShaderReflection reflection;
+	};
+
+	// Shader modules keyed by path and by content hash. Files are memory mapped and handed to the
+	// driver without a copy, a path is only read again once it changed on disk, and identical
+	// SPIR-V under different paths shares one module. Safe to call from the compile workers.
+	class ShaderRegistry {
+	public:
+		void init(VkDevice device);
+		//only once nothing is compiling any more
+		void destroy();
+
+		//nullptr on failure with the reason in error. Modules stay alive until destroy(), a reload
+		//adds a new one rather than pulling the old one out from under a compile in flight
+		const ShaderModule* load(const std::string& path, std::string* error = nullptr);
+
+		size_t module_count() const;
+
+	private:
+		struct PathEntry {
+			std::filesystem::file_time_type writeTime{};
+			uintmax_t size{ 0 };
+			const ShaderModule* shader{ nullptr };
+		};
+
+		VkDevice _device{ VK_NULL_HANDLE };
+
+		mutable std::mutex _mutex;
+		std::unordered_map<std::string, PathEntry> _paths;
+		std::unordered_map<uint64_t, std::unique_ptr<ShaderModule>> _modules;
+		std::vector<std::unique_ptr<ShaderModule>> _shadowed;
+	};
+}
+
+namespace VkUtil {
+	//false when the code isn't SPIR-V or uses something the reflection can't make sense of
+	bool reflect_shader(std::span<const uint32_t> code, GearHead::ShaderReflection& outReflection, std::string* error = nullptr);
+}
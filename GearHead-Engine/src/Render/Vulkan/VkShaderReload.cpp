@@ -0,0 +1,129 @@
+#include "VkShaderReload.hpp"
+#include "Core/Profiler.hpp"
+#include "Core/ThreadPool.hpp"
+
+#include <cstdio>
+#include <filesystem>
+
+#ifdef GEARHEAD_PLATFORM_WINDOWS
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace GearHead {
+
+	namespace {
+		ShaderCompileResult CompileShader(const std::string& compiler, const std::string& source, const std::string& output)
+		{
+			GEARHEAD_PROFILE_SCOPE("Compile Shader");
+
+			ShaderCompileResult result;
+			result.source = source;
+			result.output = output;
+
+			std::string tempPath = output + ".tmp";
+			std::string command = fmt::format("\"{0}\" -V \"{1}\" -o \"{2}\" 2>&1", compiler, source, tempPath);
+#ifdef GEARHEAD_PLATFORM_WINDOWS
+			// _popen runs cmd /c, which strips the first and last quote of the line
+			command = "\"" + command + "\"";
+#endif
+
+			FILE* pipe = popen(command.c_str(), "r");
+			if (!pipe) {
+				result.log = "could not start " + compiler;
+				return result;
+			}
+
+			char buffer[256];
+			while (fgets(buffer, sizeof(buffer), pipe)) {
+				result.log += buffer;
+			}
+			result.success = pclose(pipe) == 0;
+
+			std::error_code ec;
+			if (result.success) {
+				std::filesystem::rename(tempPath, output, ec);
+				if (ec) {
+					result.success = false;
+					result.log += ec.message();
+				}
+			}
+			if (!result.success) {
+				std::filesystem::remove(tempPath, ec);
+			}
+			return result;
+		}
+	}
+
+	bool ShaderHotReloader::init(const std::string& sourceDir, const std::string& outputDir, const std::string& compiler)
+	{
+		_outputDir = outputDir;
+		_compiler = compiler;
+
+		return _watcher.Start(sourceDir, { ".comp", ".vert", ".frag" });
+	}
+
+	void ShaderHotReloader::destroy()
+	{
+		_watcher.Stop();
+
+		for (auto& [source, compile] : _compiles) {
+			compile.wait();
+		}
+		_compiles.clear();
+		_requeue.clear();
+	}
+
+	std::vector<std::string> ShaderHotReloader::poll()
+	{
+		for (const std::string& source : _watcher.PollChanges()) {
+			if (_compiles.contains(source)) {
+				_requeue.insert(source);
+				continue;
+			}
+			queue_compile(source);
+		}
+
+		std::vector<std::string> rebuilt;
+		std::vector<std::string> requeue;
+		for (auto it = _compiles.begin(); it != _compiles.end();) {
+			if (!IsReady(it->second)) {
+				it++;
+				continue;
+			}
+
+			ShaderCompileResult result = it->second.get();
+			it = _compiles.erase(it);
+
+			//a broken shader keeps the last good pipeline running
+			if (result.success) {
+				GEARHEAD_CORE_INFO("Recompiled {0}", result.source);
+				rebuilt.push_back(result.output);
+			}
+			else {
+				GEARHEAD_CORE_ERROR("Shader {0} failed to compile:\n{1}", result.source, result.log);
+			}
+
+			if (_requeue.erase(result.source)) {
+				requeue.push_back(result.source);
+			}
+		}
+
+		//not inside the loop, inserting can rehash under the iterator
+		for (const std::string& source : requeue) {
+			queue_compile(source);
+		}
+
+		return rebuilt;
+	}
+
+	void ShaderHotReloader::queue_compile(const std::string& source)
+	{
+		//same naming as the build, foo.comp -> foo.comp.spv
+		std::string output = (std::filesystem::path(_outputDir) / std::filesystem::path(source).filename()).string() + ".spv";
+
+		_compiles.emplace(source, ThreadPool::Get().Submit([compiler = _compiler, source, output]() {
+			return CompileShader(compiler, source, output);
+			}));
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Core/FileWatcher.hpp"
+#include "ghpch.hpp"
+
+#include <future>
+
+namespace GearHead {
+
+	struct ShaderCompileResult {
+		std::string source;
+		std::string output;
+		bool success{ false };
+		std::string log;
+	};
+
+	// Recompiles GLSL sources to SPIR-V on the thread pool as they are saved, with the same compiler
+	// the build uses. The .spv is replaced atomically, so loaders never see a half written file.
+	class ShaderHotReloader {
+	public:
+		bool init(const std::string& sourceDir, const std::string& outputDir, const std::string& compiler);
+		void destroy();
+
+		//queues compiles for whatever changed, returns the .spv files rebuilt since the last call
+		std::vector<std::string> poll();
+
+		bool is_watching() const { return _watcher.IsRunning(); }
+
+	private:
+		void queue_compile(const std::string& source);
+
+		FileWatcher _watcher;
+		std::string _outputDir;
+		std::string _compiler;
+
+		//source -> compile in flight, saved again while compiling gets queued once the first is done
+		std::unordered_map<std::string, std::future<ShaderCompileResult>> _compiles;
+		std::unordered_set<std::string> _requeue;
+	};
+}
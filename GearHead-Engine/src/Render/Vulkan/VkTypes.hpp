@@ -5,8 +5,16 @@
 
 namespace GearHead {
 	struct AllocatedBuffer {
-		VkBuffer _buffer;
-		VmaAllocation _allocation;
+		VkBuffer _buffer{ VK_NULL_HANDLE };
+		VmaAllocation _allocation{ VK_NULL_HANDLE };
+		VmaAllocationInfo _info{};
+		//0 unless created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+		VkDeviceAddress _address{ 0 };
+
+		//nullptr unless the memory is host visible, those stay mapped for the buffer's whole lifetime
+		void* mapped() const { return _info.pMappedData; }
+		template<typename T>
+		T* mapped_as() const { return (T*)_info.pMappedData; }
 	};
 
 
@@ -20,6 +28,9 @@ namespace GearHead {
 
 
 
+	//separate vertex buffer bindings a vertex format may split into
+	constexpr uint32_t MAX_VERTEX_STREAMS = 2;
+
 	struct VertexInputDescription {
 		std::vector<VkVertexInputBindingDescription> bindings;
 		std::vector<VkVertexInputAttributeDescription> attributes;
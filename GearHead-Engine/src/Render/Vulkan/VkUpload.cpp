@@ -0,0 +1,347 @@
+#include "VkUpload.hpp"
+#include "VkBuffers.hpp"
+#include "VkInit.hpp"
+#include "Core/Core.hpp"
+#include "Game/Common/Types.hpp"
+
+namespace GearHead
+{
+	void StagingRing::init(VmaAllocator allocator, size_t size)
+	{
+		_allocator = allocator;
+		_capacity = size;
+		_head = 0;
+		_tail = 0;
+		_inFlight.clear();
+
+		_buffer = VkUtil::create_buffer(allocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+	}
+
+	void StagingRing::destroy()
+	{
+		if (_buffer._buffer != VK_NULL_HANDLE) {
+			VkUtil::destroy_buffer(_allocator, _buffer);
+			_buffer = {};
+		}
+	}
+
+	size_t StagingRing::allocate(size_t size, size_t alignment)
+	{
+		if (size > _capacity)
+			return INVALID_OFFSET;
+
+		//nothing in flight, start over at the front so a batch up to the whole capacity fits without wrapping.
+		//Any submissions still queued cover no bytes past the tail and can go
+		if (_head == _tail) {
+			_head = _tail = (_head + _capacity - 1) / _capacity * _capacity;
+			_inFlight.clear();
+		}
+
+		uint64_t position = _head % _capacity;
+		uint64_t offset = (position + alignment - 1) & ~uint64_t(alignment - 1);
+
+		//doesn't fit before the end, skip the tail bytes and start over at the front
+		if (offset + size > _capacity) {
+			offset = 0;
+		}
+
+		uint64_t advance = (offset >= position ? offset - position : _capacity - position) + size;
+		if (_head + advance - _tail > _capacity)
+			return INVALID_OFFSET;
+
+		_head += advance;
+		return (size_t)offset;
+	}
+
+	void StagingRing::submit(uint64_t timelineValue)
+	{
+		if (!_inFlight.empty() && _inFlight.back().head == _head)
+			return;
+
+		_inFlight.push_back({ _head, timelineValue });
+	}
+
+	void StagingRing::retire(uint64_t completedValue)
+	{
+		while (!_inFlight.empty() && _inFlight.front().timelineValue <= completedValue) {
+			_tail = _inFlight.front().head;
+			_inFlight.pop_front();
+		}
+	}
+
+	void RangeAllocator::init(uint32_t capacity)
+	{
+		_capacity = capacity;
+		_used = 0;
+		_free.clear();
+		_free[0] = capacity;
+	}
+
+	uint32_t RangeAllocator::allocate(uint32_t count)
+	{
+		if (count == 0)
+			return INVALID_RANGE;
+
+		for (auto it = _free.begin(); it != _free.end(); it++) {
+			if (it->second < count)
+				continue;
+
+			uint32_t offset = it->first;
+			uint32_t remaining = it->second - count;
+			_free.erase(it);
+			if (remaining > 0) {
+				_free[offset + count] = remaining;
+			}
+
+			_used += count;
+			return offset;
+		}
+
+		return INVALID_RANGE;
+	}
+
+	void RangeAllocator::free(uint32_t offset, uint32_t count)
+	{
+		if (offset == INVALID_RANGE || count == 0)
+			return;
+
+		_used -= count;
+
+		auto next = _free.lower_bound(offset);
+
+		//merge with the range right after
+		if (next != _free.end() && offset + count == next->first) {
+			count += next->second;
+			next = _free.erase(next);
+		}
+
+		//and with the one right before
+		if (next != _free.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset) {
+				prev->second += count;
+				return;
+			}
+		}
+
+		_free[offset] = count;
+	}
+
+	void MeshUploader::init(VmaAllocator allocator, size_t stagingSize, std::span<const uint32_t> streamStrides, uint32_t maxVertices, uint32_t maxIndices, uint32_t maxMeshlets,
+		std::span<const uint32_t> meshletQueueFamilies)
+	{
+		_allocator = allocator;
+		_streamCount = (uint32_t)std::min<size_t>(streamStrides.size(), MAX_VERTEX_STREAMS);
+
+		_staging.init(allocator, stagingSize);
+
+		for (uint32_t stream = 0; stream < _streamCount; stream++) {
+			_streamStrides[stream] = streamStrides[stream];
+			_vertexBuffers[stream] = VkUtil::create_buffer(allocator, size_t(streamStrides[stream]) * maxVertices,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		}
+		_indexBuffer = VkUtil::create_buffer(allocator, sizeof(uint32_t) * size_t(maxIndices),
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+		//only read by the cull pass, which can be on another queue than the copies
+		_meshletBuffer = VkUtil::create_buffer(allocator, sizeof(Meshlet) * size_t(maxMeshlets),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY,
+			meshletQueueFamilies);
+
+		_vertexRanges.init(maxVertices);
+		_indexRanges.init(maxIndices);
+		_meshletRanges.init(maxMeshlets);
+	}
+
+	void MeshUploader::destroy()
+	{
+		_staging.destroy();
+
+		for (uint32_t stream = 0; stream < _streamCount; stream++) {
+			VkUtil::destroy_buffer(_allocator, _vertexBuffers[stream]);
+			_vertexBuffers[stream] = {};
+		}
+
+		if (_indexBuffer._buffer != VK_NULL_HANDLE) {
+			VkUtil::destroy_buffer(_allocator, _indexBuffer);
+			_indexBuffer = {};
+		}
+		if (_meshletBuffer._buffer != VK_NULL_HANDLE) {
+			VkUtil::destroy_buffer(_allocator, _meshletBuffer);
+			_meshletBuffer = {};
+		}
+		_streamCount = 0;
+	}
+
+	UploadResult MeshUploader::reserve(uint32_t vertexCount, uint32_t indexCount, uint32_t meshletCount, MeshAllocation& outAllocation, MeshUploadSpace& outSpace)
+	{
+		//a mesh that can't fit even into empty buffers would be retried forever
+		if (vertexCount == 0 || vertexCount > _vertexRanges.capacity() || indexCount > _indexRanges.capacity())
+			return UploadResult::Rejected;
+
+		size_t stagingSize = StagingRing::footprint(size_t(indexCount) * sizeof(uint32_t));
+		for (uint32_t stream = 0; stream < _streamCount; stream++) {
+			stagingSize += StagingRing::footprint(size_t(vertexCount) * _streamStrides[stream]);
+		}
+		if (stagingSize > _staging.capacity())
+			return UploadResult::Rejected;
+
+		if (meshletCount > _meshletRanges.capacity() || stagingSize + StagingRing::footprint(size_t(meshletCount) * sizeof(Meshlet)) > _staging.capacity()) {
+			GEARHEAD_CORE_WARN("{0} meshlets can never fit the meshlet or staging buffer, mesh gets drawn whole", meshletCount);
+			meshletCount = 0;
+		}
+
+		//ranges first, they're the only part that can be handed back
+		uint32_t firstVertex = _vertexRanges.allocate(vertexCount);
+		if (firstVertex == RangeAllocator::INVALID_RANGE) {
+			GEARHEAD_CORE_LOG_RATE_LIMITED(WARN, 1000, "Geometry buffer out of vertex space ({0} used of {1})", _vertexRanges.used(), _vertexRanges.capacity());
+			return UploadResult::Retry;
+		}
+
+		uint32_t firstIndex = RangeAllocator::INVALID_RANGE;
+		if (indexCount > 0) {
+			firstIndex = _indexRanges.allocate(indexCount);
+			if (firstIndex == RangeAllocator::INVALID_RANGE) {
+				_vertexRanges.free(firstVertex, vertexCount);
+				GEARHEAD_CORE_LOG_RATE_LIMITED(WARN, 1000, "Geometry buffer out of index space ({0} used of {1})", _indexRanges.used(), _indexRanges.capacity());
+				return UploadResult::Retry;
+			}
+		}
+
+		uint32_t firstMeshlet = RangeAllocator::INVALID_RANGE;
+		if (meshletCount > 0) {
+			firstMeshlet = _meshletRanges.allocate(meshletCount);
+			if (firstMeshlet == RangeAllocator::INVALID_RANGE) {
+				GEARHEAD_CORE_LOG_RATE_LIMITED(WARN, 1000, "Meshlet buffer full ({0} used of {1}), meshes get drawn whole", _meshletRanges.used(), _meshletRanges.capacity());
+				meshletCount = 0;
+			}
+		}
+
+		//all or nothing, a partly staged mesh would keep the ring from ever draining enough for it
+		uint64_t stagingMark = _staging.mark();
+		std::array<size_t, MAX_VERTEX_STREAMS> streamOffsets{};
+		size_t indexOffset = StagingRing::INVALID_OFFSET;
+		bool staged = true;
+		for (uint32_t stream = 0; stream < _streamCount && staged; stream++) {
+			streamOffsets[stream] = _staging.allocate(size_t(vertexCount) * _streamStrides[stream]);
+			staged = streamOffsets[stream] != StagingRing::INVALID_OFFSET;
+		}
+		if (staged && indexCount > 0) {
+			indexOffset = _staging.allocate(size_t(indexCount) * sizeof(uint32_t));
+			staged = indexOffset != StagingRing::INVALID_OFFSET;
+		}
+		size_t meshletOffset = StagingRing::INVALID_OFFSET;
+		if (staged && meshletCount > 0) {
+			meshletOffset = _staging.allocate(size_t(meshletCount) * sizeof(Meshlet));
+			staged = meshletOffset != StagingRing::INVALID_OFFSET;
+		}
+
+		if (!staged) {
+			_staging.rollback(stagingMark);
+			_vertexRanges.free(firstVertex, vertexCount);
+			_indexRanges.free(firstIndex, indexCount);
+			_meshletRanges.free(firstMeshlet, meshletCount);
+			return UploadResult::Retry;
+		}
+
+		for (uint32_t stream = 0; stream < _streamCount; stream++) {
+			size_t size = size_t(vertexCount) * _streamStrides[stream];
+			outSpace.streams[stream] = (uint8_t*)_staging.data(streamOffsets[stream]);
+			_vertexCopies[stream].push_back({ streamOffsets[stream], size_t(firstVertex) * _streamStrides[stream], size });
+		}
+
+		outSpace.indices = nullptr;
+		if (indexCount > 0) {
+			outSpace.indices = (uint32_t*)_staging.data(indexOffset);
+			_indexCopies.push_back({ indexOffset, size_t(firstIndex) * sizeof(uint32_t), size_t(indexCount) * sizeof(uint32_t) });
+		}
+
+		outSpace.meshlets = nullptr;
+		if (meshletCount > 0) {
+			outSpace.meshlets = (Meshlet*)_staging.data(meshletOffset);
+			_meshletCopies.push_back({ meshletOffset, size_t(firstMeshlet) * sizeof(Meshlet), size_t(meshletCount) * sizeof(Meshlet) });
+		}
+
+		_hasPending = true;
+
+		outAllocation.firstVertex = firstVertex;
+		outAllocation.vertexCount = vertexCount;
+		outAllocation.firstIndex = firstIndex;
+		outAllocation.indexCount = indexCount;
+		outAllocation.firstMeshlet = firstMeshlet;
+		outAllocation.meshletCount = meshletCount;
+		outAllocation.uploadBatch = _recordedBatches + 1;
+		return UploadResult::Uploaded;
+	}
+
+	UploadResult MeshUploader::upload(std::span<const std::span<const uint8_t>> streams, std::span<const uint32_t> indices, std::span<const Meshlet> meshlets, MeshAllocation& outAllocation)
+	{
+		if (streams.size() != _streamCount || _streamCount == 0)
+			return UploadResult::Rejected;
+
+		uint32_t vertexCount = uint32_t(streams[0].size() / _streamStrides[0]);
+
+		MeshUploadSpace space;
+		UploadResult result = reserve(vertexCount, (uint32_t)indices.size(), (uint32_t)meshlets.size(), outAllocation, space);
+		if (result != UploadResult::Uploaded)
+			return result;
+
+		for (uint32_t stream = 0; stream < _streamCount; stream++) {
+			memcpy(space.streams[stream], streams[stream].data(), size_t(vertexCount) * _streamStrides[stream]);
+		}
+		if (!indices.empty()) {
+			memcpy(space.indices, indices.data(), indices.size_bytes());
+		}
+		if (space.meshlets) {
+			memcpy(space.meshlets, meshlets.data(), meshlets.size_bytes());
+		}
+
+		return UploadResult::Uploaded;
+	}
+
+	void MeshUploader::free(const MeshAllocation& allocation)
+	{
+		_vertexRanges.free(allocation.firstVertex, allocation.vertexCount);
+		_indexRanges.free(allocation.firstIndex, allocation.indexCount);
+		_meshletRanges.free(allocation.firstMeshlet, allocation.meshletCount);
+	}
+
+	void MeshUploader::record(VkCommandBuffer cmd)
+	{
+		if (!_hasPending)
+			return;
+
+		for (uint32_t stream = 0; stream < _streamCount; stream++) {
+			std::vector<VkBufferCopy>& copies = _vertexCopies[stream];
+			if (!copies.empty()) {
+				vkCmdCopyBuffer(cmd, _staging.buffer(), _vertexBuffers[stream]._buffer, (uint32_t)copies.size(), copies.data());
+				copies.clear();
+			}
+		}
+		if (!_indexCopies.empty()) {
+			vkCmdCopyBuffer(cmd, _staging.buffer(), _indexBuffer._buffer, (uint32_t)_indexCopies.size(), _indexCopies.data());
+			_indexCopies.clear();
+		}
+		if (!_meshletCopies.empty()) {
+			vkCmdCopyBuffer(cmd, _staging.buffer(), _meshletBuffer._buffer, (uint32_t)_meshletCopies.size(), _meshletCopies.data());
+			_meshletCopies.clear();
+		}
+
+		_hasPending = false;
+		_recordedBatches++;
+
+		//one global barrier covers every region of every buffer
+		VkMemoryBarrier2 barrier{ .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		//vertices are pulled in the vertex shader through their device address, only indices go through input assembly
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_INDEX_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+
+		VkDependencyInfo depInfo{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+		depInfo.memoryBarrierCount = 1;
+		depInfo.pMemoryBarriers = &barrier;
+
+		vkCmdPipelineBarrier2(cmd, &depInfo);
+	}
+}
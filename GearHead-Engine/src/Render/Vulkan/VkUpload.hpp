@@ -0,0 +1,158 @@
+#pragma once
+#include "VkTypes.hpp"
+#include "ghpch.hpp"
+
+namespace GearHead
+{
+	struct Meshlet;
+
+	// Persistently mapped upload buffer used as a ring. Space handed out since the last submit is
+	// tagged with that submission's timeline value and comes back once the GPU has passed it.
+	class StagingRing {
+	public:
+		static constexpr size_t INVALID_OFFSET = ~size_t(0);
+
+		void init(VmaAllocator allocator, size_t size);
+		void destroy();
+
+		//returns INVALID_OFFSET when the ring is full until older submissions retire
+		size_t allocate(size_t size, size_t alignment = 16);
+		//ring space size takes at alignment, a batch of allocations totalling at most capacity() always fits once the ring drains
+		static size_t footprint(size_t size, size_t alignment = 16) { return (size + alignment - 1) & ~(alignment - 1); }
+		//hands back everything allocated since mark(), only valid before the next submit
+		uint64_t mark() const { return _head; }
+		//the tail can have moved past the mark if allocate() restarted an empty ring at the front
+		void rollback(uint64_t mark) { _head = std::max(mark, _tail); }
+		void* data(size_t offset) const { return (uint8_t*)_buffer._info.pMappedData + offset; }
+		VkBuffer buffer() const { return _buffer._buffer; }
+		size_t capacity() const { return _capacity; }
+		size_t used() const { return size_t(_head - _tail); }
+
+		void submit(uint64_t timelineValue);
+		void retire(uint64_t completedValue);
+
+	private:
+		struct Submission {
+			uint64_t head;
+			uint64_t timelineValue;
+		};
+
+		VmaAllocator _allocator{ VK_NULL_HANDLE };
+		AllocatedBuffer _buffer{};
+		size_t _capacity{ 0 };
+
+		//monotonic byte positions, the offset into the buffer is position % capacity
+		uint64_t _head{ 0 };
+		uint64_t _tail{ 0 };
+		std::deque<Submission> _inFlight;
+	};
+
+	// First fit sub allocator over a range of elements, neighbouring free ranges get merged.
+	class RangeAllocator {
+	public:
+		static constexpr uint32_t INVALID_RANGE = ~0u;
+
+		void init(uint32_t capacity);
+		uint32_t allocate(uint32_t count);
+		void free(uint32_t offset, uint32_t count);
+
+		uint32_t capacity() const { return _capacity; }
+		uint32_t used() const { return _used; }
+
+	private:
+		uint32_t _capacity{ 0 };
+		uint32_t _used{ 0 };
+		//offset -> count
+		std::map<uint32_t, uint32_t> _free;
+	};
+
+	// Where a mesh lives inside the shared geometry buffers
+	struct MeshAllocation {
+		uint32_t firstVertex{ RangeAllocator::INVALID_RANGE };
+		uint32_t vertexCount{ 0 };
+		uint32_t firstIndex{ RangeAllocator::INVALID_RANGE };
+		uint32_t indexCount{ 0 };
+		//meshlet buffer range, empty for meshes that are drawn whole
+		uint32_t firstMeshlet{ RangeAllocator::INVALID_RANGE };
+		uint32_t meshletCount{ 0 };
+		//MeshUploader::recorded_batches() value from which its copies are in a command buffer
+		uint64_t uploadBatch{ 0 };
+
+		bool valid() const { return firstVertex != RangeAllocator::INVALID_RANGE; }
+	};
+
+	enum class UploadResult {
+		Uploaded,
+		//out of staging or geometry space for now, try again next frame
+		Retry,
+		//never fits however long the caller waits: no vertices, or bigger than the staging ring or the geometry buffers
+		Rejected
+	};
+
+	// Staging memory handed out by MeshUploader::reserve, fill it in before the frame records
+	struct MeshUploadSpace {
+		std::array<uint8_t*, MAX_VERTEX_STREAMS> streams{};
+		uint32_t* indices{ nullptr };
+		Meshlet* meshlets{ nullptr };
+	};
+
+	// Shared GPU only vertex, index and meshlet buffers that meshes are sub allocated from, one vertex buffer
+	// per stream of the vertex format, all indexed by the same vertex range. Uploads go through the staging
+	// ring and get recorded as one batch of copies at the start of the next frame.
+	class MeshUploader {
+	public:
+		void init(VmaAllocator allocator, size_t stagingSize, std::span<const uint32_t> streamStrides, uint32_t maxVertices, uint32_t maxIndices, uint32_t maxMeshlets,
+			std::span<const uint32_t> meshletQueueFamilies = {});
+		void destroy();
+
+		//Retry when the staging ring or the geometry buffers are out of room for now. Running out of meshlet
+		//space isn't fatal, the mesh gets no meshlets and is drawn whole
+		UploadResult reserve(uint32_t vertexCount, uint32_t indexCount, uint32_t meshletCount, MeshAllocation& outAllocation, MeshUploadSpace& outSpace);
+		//reserve + copy, one span per stream
+		UploadResult upload(std::span<const std::span<const uint8_t>> streams, std::span<const uint32_t> indices, std::span<const Meshlet> meshlets, MeshAllocation& outAllocation);
+		//only once the GPU is done with every frame that could draw it
+		void free(const MeshAllocation& allocation);
+
+		//records every pending copy plus the barrier that makes them visible to index input and shaders
+		void record(VkCommandBuffer cmd);
+		void submit(uint64_t timelineValue) { _staging.submit(timelineValue); }
+		void retire(uint64_t completedValue) { _staging.retire(completedValue); }
+
+		bool has_pending() const { return _hasPending; }
+		//how many times pending copies were recorded
+		uint64_t recorded_batches() const { return _recordedBatches; }
+
+		uint32_t stream_count() const { return _streamCount; }
+		VkBuffer vertex_buffer(uint32_t stream) const { return _vertexBuffers[stream]._buffer; }
+		VkBuffer index_buffer() const { return _indexBuffer._buffer; }
+		//vertex shaders pull from these, there are no vertex buffer bindings
+		VkDeviceAddress vertex_address(uint32_t stream) const { return _vertexBuffers[stream]._address; }
+		VkDeviceAddress index_address() const { return _indexBuffer._address; }
+		VkDeviceAddress meshlet_address() const { return _meshletBuffer._address; }
+		uint32_t vertex_stride(uint32_t stream) const { return _streamStrides[stream]; }
+
+		const StagingRing& staging() const { return _staging; }
+		const RangeAllocator& vertex_ranges() const { return _vertexRanges; }
+		const RangeAllocator& index_ranges() const { return _indexRanges; }
+		const RangeAllocator& meshlet_ranges() const { return _meshletRanges; }
+
+	private:
+		VmaAllocator _allocator{ VK_NULL_HANDLE };
+		StagingRing _staging;
+
+		uint32_t _streamCount{ 0 };
+		std::array<uint32_t, MAX_VERTEX_STREAMS> _streamStrides{};
+		std::array<AllocatedBuffer, MAX_VERTEX_STREAMS> _vertexBuffers{};
+		AllocatedBuffer _indexBuffer{};
+		RangeAllocator _vertexRanges;
+		RangeAllocator _indexRanges;
+		AllocatedBuffer _meshletBuffer{};
+		RangeAllocator _meshletRanges;
+
+		bool _hasPending{ false };
+		uint64_t _recordedBatches{ 0 };
+		std::array<std::vector<VkBufferCopy>, MAX_VERTEX_STREAMS> _vertexCopies;
+		std::vector<VkBufferCopy> _indexCopies;
+		std::vector<VkBufferCopy> _meshletCopies;
+	};
+}
@@ -5,6 +5,11 @@
 #include "VkWindow.hpp"
 #include "VkPipeline.hpp"
 #include "VkImages.hpp"
+#include "VkBuffers.hpp"
+#include "VkHeadlessWindow.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <bit>
 
 //ImGUI
 #include <imgui.h>
@@ -21,9 +26,34 @@
 namespace GearHead {
 
 	static bool s_GLFWInitialized = false;
-	static bool s_VKInitialized = false;
 
-	Window* Window::Create(const WindowProps& props) { return new VkWindow(props); }
+	//mip 0 of the depth pyramid is half the extent rounded up, every level after halves again down to 1x1
+	static uint32_t DepthPyramidLevels(VkExtent2D extent)
+	{
+		uint32_t size = std::max((extent.width + 1) / 2, (extent.height + 1) / 2);
+		uint32_t levels = 1;
+		while (size > 1) {
+			size = (size + 1) / 2;
+			levels++;
+		}
+		return std::min(levels, MAX_DEPTH_PYRAMID_LEVELS);
+	}
+
+	Window* Window::Create(const WindowProps& props) 
+	{
+		// GEARHEAD_HEADLESS=<frames> forces the offscreen backend, used by CI and the render farm
+		if (const char* headless = std::getenv("GEARHEAD_HEADLESS")) {
+			WindowProps headlessProps = props;
+			headlessProps.Headless = true;
+			headlessProps.HeadlessFrames = static_cast<unsigned int>(std::strtoul(headless, nullptr, 10));
+			return new VkHeadlessWindow(headlessProps);
+		}
+
+		if (props.Headless)
+			return new VkHeadlessWindow(props);
+
+		return new VkWindow(props);
+	}
 
 
 	VkWindow::VkWindow(const WindowProps& props) { Init(props); }
@@ -49,17 +79,27 @@ namespace GearHead {
 
 		SetVSync(true);
 
+		_framesInFlight = std::clamp(props.FramesInFlight, 1U, MAX_FRAMES_IN_FLIGHT);
+
 		//Vulkan
+		auto initStart = std::chrono::high_resolution_clock::now();
 
 		InitVulkan();
 		InitSwapchain();
 		InitCommands();
 		InitSyncStructures();
+		CalibrateGpuClock();
+		InitGeometry();
 		InitDescriptors();
+		InitPipelineCache();
 		InitPipelines();
+		InitShaderHotReload();
 		InitImGUI();
 
-		s_VKInitialized = true;
+		_startupStats.initMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - initStart).count();
+		GEARHEAD_CORE_INFO("Renderer initialized in {0:.2f} ms", _startupStats.initMs);
+
+		isInitialized = true;
 
 	}
 
@@ -77,22 +117,28 @@ namespace GearHead {
 		//	   Window(GLFW)
 
 
-		if (s_VKInitialized) {
+		if (isInitialized) {
 
 			vkDeviceWaitIdle(_device);
 			_mainDeletionQueue.flush();
 
-			DestroySwapChain();
-			vkDestroySurfaceKHR(_instance, _surface, nullptr);
+			//headless backends never create a swapchain or surface
+			if (_swapchain != VK_NULL_HANDLE)
+				DestroySwapChain();
+			if (_surface != VK_NULL_HANDLE)
+				vkDestroySurfaceKHR(_instance, _surface, nullptr);
 
 			vkDestroyDevice(_device, nullptr);
 			vkb::destroy_debug_utils_messenger(_instance, _debugMessenger);
 			vkDestroyInstance(_instance, nullptr);
+
+			isInitialized = false;
 		}
 
-		if (s_GLFWInitialized)
+		if (s_GLFWInitialized && _window)
 		{
 			glfwDestroyWindow(_window);
+			_window = nullptr;
 		}
 
 	}
@@ -105,6 +151,7 @@ namespace GearHead {
 		auto instRet = builder.set_app_name(mData.props.Title.c_str())
 			.set_engine_name("GearHead-Engine")
 			.request_validation_layers(true)
+			.set_headless(_headless)
 			.require_api_version(1,3,0)
 			.set_debug_callback( // add custom debug callback. need to store the logs
 				[] (VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -131,26 +178,52 @@ namespace GearHead {
 			GEARHEAD_CORE_CRITICAL("Instance not assigned");
 		}
 
-		GEARHEAD_VKSUCCESS_CHECK(glfwCreateWindowSurface(_instance, _window, nullptr, &_surface));
+		//no surface when headless, so the device does not need to be present capable
+		if (!_headless) {
+			GEARHEAD_VKSUCCESS_CHECK(glfwCreateWindowSurface(_instance, _window, nullptr, &_surface));
+		}
 
 		VkPhysicalDeviceVulkan13Features features{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
 		features.dynamicRendering = true;
 		features.synchronization2 = true;
 
+		//one storage image table holds every format, so shaders write without declaring one
+		VkPhysicalDeviceFeatures features10{};
+		features10.shaderStorageImageWriteWithoutFormat = true;
+		//cull.comp writes one indirect draw per visible instance, each finding its instance through firstInstance
+		features10.multiDrawIndirect = true;
+		features10.drawIndirectFirstInstance = true;
+
 		//vulkan 1.2 features
 		VkPhysicalDeviceVulkan12Features features12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
 		features12.bufferDeviceAddress = true;
+		features12.drawIndirectCount = true;
 		features12.descriptorIndexing = true;
+		//descriptorIndexing alone only turns on the extension, the bindless heap needs these parts of it
+		features12.runtimeDescriptorArray = true;
+		features12.descriptorBindingPartiallyBound = true;
+		features12.descriptorBindingUpdateUnusedWhilePending = true;
+		features12.descriptorBindingSampledImageUpdateAfterBind = true;
+		features12.descriptorBindingStorageImageUpdateAfterBind = true;
+		features12.descriptorBindingStorageBufferUpdateAfterBind = true;
+		features12.shaderSampledImageArrayNonUniformIndexing = true;
+		features12.shaderStorageImageArrayNonUniformIndexing = true;
+		features12.shaderStorageBufferArrayNonUniformIndexing = true;
+		features12.timelineSemaphore = true;
+		features12.hostQueryReset = true;
 
 		vkb::PhysicalDeviceSelector selector{ vkbInstance };
 
-		vkb::PhysicalDevice physicalDevice = selector
+		selector
 			.set_minimum_version(1, 3)
+			.set_required_features(features10)
 			.set_required_features_13(features)
-			.set_required_features_12(features12)
-			.set_surface(_surface)
-			.select()
-			.value();
+			.set_required_features_12(features12);
+
+		if (!_headless)
+			selector.set_surface(_surface);
+
+		vkb::PhysicalDevice physicalDevice = selector.select().value();
 
 
 
@@ -165,6 +238,20 @@ namespace GearHead {
 		_graphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
 		_graphicsQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
 
+		//grab a compute queue from a family other than graphics if there is one, otherwise stay on a single queue
+		auto computeQueue = vkbDevice.get_queue(vkb::QueueType::compute);
+		if (computeQueue.has_value()) {
+			_computeQueue = computeQueue.value();
+			_computeQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::compute).value();
+			_asyncCompute = true;
+			GEARHEAD_CORE_INFO("Async compute enabled on queue family {0}", _computeQueueFamily);
+		}
+		else {
+			_computeQueue = _graphicsQueue;
+			_computeQueueFamily = _graphicsQueueFamily;
+			GEARHEAD_CORE_INFO("No separate compute queue, background effects stay on the graphics queue");
+		}
+
 		VmaAllocatorCreateInfo allocatorInfo = {};
 		allocatorInfo.physicalDevice = _chosenGPU;
 		allocatorInfo.device = _device;
@@ -174,6 +261,14 @@ namespace GearHead {
 
 		_mainDeletionQueue.push_function([&]() { vmaDestroyAllocator(_allocator); });
 
+		//sized for the most frames in flight so changing the count never touches it
+		_gpuProfiler.init(_device, _chosenGPU, { _graphicsQueueFamily, _computeQueueFamily }, MAX_FRAMES_IN_FLIGHT);
+		_mainDeletionQueue.push_function([=]() { _gpuProfiler.destroy(); });
+
+		//before the draw image, which is the first thing to take a slot
+		_bindless.init(_device, _chosenGPU);
+		_mainDeletionQueue.push_function([=]() { _bindless.destroy(); });
+
 		GEARHEAD_CORE_INFO("Using GPU: {0}", physicalDevice.name);
 	}
 
@@ -181,10 +276,31 @@ namespace GearHead {
 	{
 		CreateSwapChain(mData.props.Width, mData.props.Height);
 
-		//draw image size will match the window
+		InitDrawImage();
+	}
+
+	void VkWindow::InitDrawImage()
+	{
+		// allocate once at a high-water mark so resizing never reallocates it, only _drawExtent changes.
+		// the largest the window can reasonably get is the monitor it's on
+		VkExtent2D capacity = mData.toVkExtent2D();
+		if (!_headless) {
+			if (const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor())) {
+				capacity.width = std::max(capacity.width, (uint32_t)mode->width);
+				capacity.height = std::max(capacity.height, (uint32_t)mode->height);
+			}
+		}
+
+		CreateDrawImage(capacity);
+
+		_mainDeletionQueue.push_function([=]() { DestroyDrawImage(); });
+	}
+
+	void VkWindow::CreateDrawImage(VkExtent2D extent)
+	{
 		VkExtent3D drawImageExtent = {
-			mData.props.Width,
-			mData.props.Height,
+			extent.width,
+			extent.height,
 			1
 		};
 
@@ -200,6 +316,14 @@ namespace GearHead {
 
 		VkImageCreateInfo rimg_info = VkInit::image_create_info(_drawImage.imageFormat, drawImageUsages, drawImageExtent);
 
+		//written on the compute queue and read on the graphics queue, share it instead of doing ownership transfers
+		uint32_t queueFamilies[] = { _graphicsQueueFamily, _computeQueueFamily };
+		if (_asyncCompute) {
+			rimg_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			rimg_info.queueFamilyIndexCount = 2;
+			rimg_info.pQueueFamilyIndices = queueFamilies;
+		}
+
 		//for the draw image, we want to allocate it from gpu local memory
 		VmaAllocationCreateInfo rimg_allocinfo = {};
 		rimg_allocinfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
@@ -213,30 +337,112 @@ namespace GearHead {
 
 		GEARHEAD_VKSUCCESS_CHECK(vkCreateImageView(_device, &rview_info, nullptr, &_drawImage.imageView));
 
-		//add to deletion queues
-		_mainDeletionQueue.push_function([=]() {
-			vkDestroyImageView(_device, _drawImage.imageView, nullptr);
-			vmaDestroyImage(_allocator, _drawImage.image, _drawImage.allocation);
-			});
+		//depth is only touched by the graphics queue
+		_depthImage.imageFormat = DEPTH_FORMAT;
+		_depthImage.imageExtent = drawImageExtent;
+
+		//sampled by the depth pyramid build
+		VkImageCreateInfo dimg_info = VkInit::image_create_info(_depthImage.imageFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, drawImageExtent);
+		vmaCreateImage(_allocator, &dimg_info, &rimg_allocinfo, &_depthImage.image, &_depthImage.allocation, nullptr);
+
+		VkImageViewCreateInfo dview_info = VkInit::imageview_create_info(_depthImage.imageFormat, _depthImage.image, VK_IMAGE_ASPECT_DEPTH_BIT);
+		GEARHEAD_VKSUCCESS_CHECK(vkCreateImageView(_device, &dview_info, nullptr, &_depthImage.imageView));
+
+		//built on the graphics queue, read by the cull pass on the compute queue
+		VkExtent3D pyramidExtent = { std::bit_ceil((extent.width + 1) / 2), std::bit_ceil((extent.height + 1) / 2), 1 };
+		uint32_t registeredMips = _depthPyramidMipCount;
+		_depthPyramidMipCount = std::min((uint32_t)std::bit_width(std::max(pyramidExtent.width, pyramidExtent.height)), MAX_DEPTH_PYRAMID_LEVELS);
+		_depthPyramid.imageFormat = VK_FORMAT_R32_SFLOAT;
+		_depthPyramid.imageExtent = pyramidExtent;
+
+		VkImageCreateInfo pimg_info = VkInit::image_create_info(_depthPyramid.imageFormat, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, pyramidExtent);
+		pimg_info.mipLevels = _depthPyramidMipCount;
+		if (_asyncCompute) {
+			pimg_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			pimg_info.queueFamilyIndexCount = 2;
+			pimg_info.pQueueFamilyIndices = queueFamilies;
+		}
+		vmaCreateImage(_allocator, &pimg_info, &rimg_allocinfo, &_depthPyramid.image, &_depthPyramid.allocation, nullptr);
+
+		VkImageViewCreateInfo pview_info = VkInit::imageview_create_info(_depthPyramid.imageFormat, _depthPyramid.image, VK_IMAGE_ASPECT_COLOR_BIT);
+		pview_info.subresourceRange.levelCount = _depthPyramidMipCount;
+		GEARHEAD_VKSUCCESS_CHECK(vkCreateImageView(_device, &pview_info, nullptr, &_depthPyramid.imageView));
+
+		pview_info.subresourceRange.levelCount = 1;
+		for (uint32_t mip = 0; mip < _depthPyramidMipCount; mip++) {
+			pview_info.subresourceRange.baseMipLevel = mip;
+			GEARHEAD_VKSUCCESS_CHECK(vkCreateImageView(_device, &pview_info, nullptr, &_depthPyramidMips[mip]));
+		}
+
+		//same slot across resizes, by the time it gets rewritten nothing in flight uses the old view
+		if (_drawImageIndex == INVALID_BINDLESS_INDEX) {
+			_drawImageIndex = _bindless.add_storage_image(_drawImage.imageView);
+		}
+		else {
+			_bindless.update_storage_image(_drawImageIndex, _drawImage.imageView);
+		}
+
+		if (_depthImageIndex == INVALID_BINDLESS_INDEX) {
+			_depthImageIndex = _bindless.add_sampled_image(_depthImage.imageView, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+			_depthPyramidIndex = _bindless.add_sampled_image(_depthPyramid.imageView, VK_IMAGE_LAYOUT_GENERAL);
+		}
+		else {
+			_bindless.update_sampled_image(_depthImageIndex, _depthImage.imageView, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+			_bindless.update_sampled_image(_depthPyramidIndex, _depthPyramid.imageView, VK_IMAGE_LAYOUT_GENERAL);
+		}
+
+		//each mip is written as a storage image and read back as a sampled one by the level after it
+		for (uint32_t mip = 0; mip < _depthPyramidMipCount; mip++) {
+			if (mip < registeredMips) {
+				_bindless.update_storage_image(_depthPyramidStorageIndices[mip], _depthPyramidMips[mip]);
+				_bindless.update_sampled_image(_depthPyramidSampledIndices[mip], _depthPyramidMips[mip], VK_IMAGE_LAYOUT_GENERAL);
+			}
+			else {
+				_depthPyramidStorageIndices[mip] = _bindless.add_storage_image(_depthPyramidMips[mip]);
+				_depthPyramidSampledIndices[mip] = _bindless.add_sampled_image(_depthPyramidMips[mip], VK_IMAGE_LAYOUT_GENERAL);
+			}
+		}
+		//the new image has nothing in it yet
+		_depthPyramidValid = false;
 
+		GEARHEAD_CORE_INFO("Draw image allocated at {0}x{1}", extent.width, extent.height);
 	}
 
-	void VkWindow::InitCommands() {
+	void VkWindow::DestroyDrawImage()
+	{
+		vkDestroyImageView(_device, _drawImage.imageView, nullptr);
+		vmaDestroyImage(_allocator, _drawImage.image, _drawImage.allocation);
 
-		VkCommandPoolCreateInfo commandPoolInfo = VkInit::command_pool_create_info(_graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
-		for (int i = 0; i < FRAME_OVERLAP; i++) {
-			//Create the Command Pool
-			GEARHEAD_VKSUCCESS_CHECK(vkCreateCommandPool(_device, &commandPoolInfo, nullptr, &_frames[i]._pool));
+		vkDestroyImageView(_device, _depthImage.imageView, nullptr);
+		vmaDestroyImage(_allocator, _depthImage.image, _depthImage.allocation);
 
-			//Create the Command Buffer
-			VkCommandBufferAllocateInfo cmdAllocInfo = VkInit::command_buffer_allocate_info(_frames[i]._pool, 1U);
-			GEARHEAD_VKSUCCESS_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_frames[i]._buffer));
-			_mainDeletionQueue.push_function([=]() {
-				vkDestroyCommandPool(_device, _frames[i]._pool, nullptr);
-				_frames[i]._deletionQueue.flush();
-				}
-			);
+		for (uint32_t mip = 0; mip < _depthPyramidMipCount; mip++) {
+			vkDestroyImageView(_device, _depthPyramidMips[mip], nullptr);
 		}
+		vkDestroyImageView(_device, _depthPyramid.imageView, nullptr);
+		vmaDestroyImage(_allocator, _depthPyramid.image, _depthPyramid.allocation);
+	}
+
+	void VkWindow::GrowDrawImage(VkExtent2D extent)
+	{
+		if (extent.width <= _drawImage.imageExtent.width && extent.height <= _drawImage.imageExtent.height)
+			return;
+
+		//only happens when the window outgrows the monitor it started on. Frames in flight still render
+		//into the old image, so this is the one resize path that still has to idle the gpu
+		vkDeviceWaitIdle(_device);
+
+		DestroyDrawImage();
+		CreateDrawImage({ std::max(extent.width, _drawImage.imageExtent.width), std::max(extent.height, _drawImage.imageExtent.height) });
+	}
+
+
+	void VkWindow::InitCommands() {
+
+		InitFrames();
+		_mainDeletionQueue.push_function([=]() { DestroyFrames(); });
+
+		VkCommandPoolCreateInfo commandPoolInfo = VkInit::command_pool_create_info(_graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 		GEARHEAD_VKSUCCESS_CHECK(vkCreateCommandPool(_device, &commandPoolInfo, nullptr, &_immCommandPool));
 
 		//Allocate the command buffer for immediate submits
@@ -252,74 +458,240 @@ namespace GearHead {
 
 	}
 
-	void VkWindow::InitSyncStructures()
+	void VkWindow::InitFrames()
 	{
-		VkFenceCreateInfo fenceCreateInfo = VkInit::fence_create_info(VK_FENCE_CREATE_SIGNALED_BIT);
+		_frames.resize(_framesInFlight);
+
+		VkCommandPoolCreateInfo commandPoolInfo = VkInit::command_pool_create_info(_graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+		VkCommandPoolCreateInfo computePoolInfo = VkInit::command_pool_create_info(_computeQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 		VkSemaphoreCreateInfo semaphoreCreateInfo = VkInit::semaphore_create_info();
-		for (int i = 0; i < FRAME_OVERLAP; i++) {
-			GEARHEAD_VKSUCCESS_CHECK(vkCreateFence(_device, &fenceCreateInfo, nullptr, &_frames[i]._renderFence));
-			GEARHEAD_VKSUCCESS_CHECK(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_frames[i]._SwapChainSemaphore));
-			GEARHEAD_VKSUCCESS_CHECK(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_frames[i]._renderSemaphore));
-			_mainDeletionQueue.push_function([=]() {
-				vkDestroyFence(_device, _frames[i]._renderFence, nullptr);
-				vkDestroySemaphore(_device, _frames[i]._renderSemaphore, nullptr);
-				vkDestroySemaphore(_device, _frames[i]._SwapChainSemaphore, nullptr);
-				});
+
+		//the cull pass runs on the compute queue when there is one, the draws it writes are read on graphics
+		uint32_t queueFamilies[] = { _graphicsQueueFamily, _computeQueueFamily };
+		std::span<const uint32_t> sharedFamilies = _asyncCompute ? std::span<const uint32_t>(queueFamilies) : std::span<const uint32_t>();
+
+		for (FrameData& frame : _frames) {
+			//Create the Command Pool
+			GEARHEAD_VKSUCCESS_CHECK(vkCreateCommandPool(_device, &commandPoolInfo, nullptr, &frame._pool));
+
+			//Create the Command Buffer
+			VkCommandBufferAllocateInfo cmdAllocInfo = VkInit::command_buffer_allocate_info(frame._pool, 1U);
+			GEARHEAD_VKSUCCESS_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &frame._buffer));
+
+			if (_asyncCompute) {
+				GEARHEAD_VKSUCCESS_CHECK(vkCreateCommandPool(_device, &computePoolInfo, nullptr, &frame._computePool));
+
+				VkCommandBufferAllocateInfo computeAllocInfo = VkInit::command_buffer_allocate_info(frame._computePool, 1U);
+				GEARHEAD_VKSUCCESS_CHECK(vkAllocateCommandBuffers(_device, &computeAllocInfo, &frame._computeBuffer));
+			}
+
+			//binary semaphores are still needed for acquire/present, the swapchain can't use timelines
+			GEARHEAD_VKSUCCESS_CHECK(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &frame._SwapChainSemaphore));
+			GEARHEAD_VKSUCCESS_CHECK(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &frame._renderSemaphore));
+
+			frame._frameDescriptors.init(_device, 16, DESCRIPTOR_POOL_RATIOS);
+
+			//host visible, so the scene is written without a copy and shaders read it by address
+			frame._instanceBuffer = VkUtil::create_buffer(_allocator, sizeof(GPUInstance) * MAX_SCENE_INSTANCES,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, sharedFamilies);
+			frame._instanceVersion = 0;
+			frame._cullDataBuffer = VkUtil::create_buffer(_allocator, sizeof(GPUCullData),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+			frame._drawCommandBuffer = VkUtil::create_buffer(_allocator, sizeof(VkDrawIndexedIndirectCommand) * MAX_SCENE_DRAWS,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY, sharedFamilies);
+			//cleared with a fill before every cull pass
+			frame._drawCountBuffer = VkUtil::create_buffer(_allocator, sizeof(uint32_t),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VMA_MEMORY_USAGE_GPU_ONLY, sharedFamilies);
+			//the header is reset with an update before every cull pass
+			frame._clusterWorkBuffer = VkUtil::create_buffer(_allocator, sizeof(GPUClusterWork) + sizeof(uint32_t) * MAX_CLUSTER_INSTANCES,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VMA_MEMORY_USAGE_GPU_ONLY);
+
+			frame._timelineValue = 0;
+		}
+	}
+
+	void VkWindow::DestroyFrames()
+	{
+		for (FrameData& frame : _frames) {
+			frame._deletionQueue.flush();
+			frame._frameDescriptors.destroy_pools(_device);
+			VkUtil::destroy_buffer(_allocator, frame._instanceBuffer);
+			VkUtil::destroy_buffer(_allocator, frame._cullDataBuffer);
+			VkUtil::destroy_buffer(_allocator, frame._drawCommandBuffer);
+			VkUtil::destroy_buffer(_allocator, frame._drawCountBuffer);
+			VkUtil::destroy_buffer(_allocator, frame._clusterWorkBuffer);
+
+			vkDestroyCommandPool(_device, frame._pool, nullptr);
+			if (frame._computePool != VK_NULL_HANDLE) {
+				vkDestroyCommandPool(_device, frame._computePool, nullptr);
+			}
+
+			vkDestroySemaphore(_device, frame._renderSemaphore, nullptr);
+			vkDestroySemaphore(_device, frame._SwapChainSemaphore, nullptr);
 		}
 
+		_frames.clear();
+	}
+
+	void VkWindow::InitSyncStructures()
+	{
+		VkFenceCreateInfo fenceCreateInfo = VkInit::fence_create_info(VK_FENCE_CREATE_SIGNALED_BIT);
+
 		GEARHEAD_VKSUCCESS_CHECK(vkCreateFence(_device, &fenceCreateInfo, nullptr, &_immFence));
 		_mainDeletionQueue.push_function([=]() { vkDestroyFence(_device, _immFence, nullptr); });
 
+		//one timeline per queue paces the frames, plus the blit timeline for handing the draw image back to compute
+		VkSemaphoreTypeCreateInfo timelineInfo = VkInit::semaphore_type_create_info(VK_SEMAPHORE_TYPE_TIMELINE, 0);
+		VkSemaphoreCreateInfo timelineCreateInfo = VkInit::semaphore_create_info();
+		timelineCreateInfo.pNext = &timelineInfo;
+
+		GEARHEAD_VKSUCCESS_CHECK(vkCreateSemaphore(_device, &timelineCreateInfo, nullptr, &_graphicsTimeline));
+		GEARHEAD_VKSUCCESS_CHECK(vkCreateSemaphore(_device, &timelineCreateInfo, nullptr, &_computeTimeline));
+		GEARHEAD_VKSUCCESS_CHECK(vkCreateSemaphore(_device, &timelineCreateInfo, nullptr, &_blitTimeline));
+		_mainDeletionQueue.push_function([=]() {
+			vkDestroySemaphore(_device, _graphicsTimeline, nullptr);
+			vkDestroySemaphore(_device, _computeTimeline, nullptr);
+			vkDestroySemaphore(_device, _blitTimeline, nullptr);
+			});
+
 	}
 
-	void VkWindow::InitDescriptors()
+	void VkWindow::InitGeometry()
 	{
-		//create a descriptor pool that will hold 10 sets with 1 image each
-		std::vector<DescriptorAllocator::PoolSizeRatio> sizes =
-		{
-			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 }
-		};
+		VertexFormatInfo format = Vertex::get_format_info(GEOMETRY_VERTEX_FORMAT);
+		//meshlets are read by the cull pass, on the compute queue when there is one
+		uint32_t queueFamilies[] = { _graphicsQueueFamily, _computeQueueFamily };
+		std::span<const uint32_t> meshletFamilies = _asyncCompute ? std::span<const uint32_t>(queueFamilies) : std::span<const uint32_t>();
+		_meshUploader.init(_allocator, STAGING_BUFFER_SIZE, std::span(format.strides, format.streamCount), MAX_GEOMETRY_VERTICES, MAX_GEOMETRY_INDICES,
+			MAX_GEOMETRY_MESHLETS, meshletFamilies);
+		_mainDeletionQueue.push_function([=]() { _meshUploader.destroy(); });
+	}
 
-		GlobalDescriptorAllocator.init_pool(_device, 10, sizes);
+	void VkWindow::WaitForFrame(FrameData& frame)
+	{
+		GEARHEAD_PROFILE_FUNCTION();
 
-		//make the descriptor set layout for our compute draw
-		{
-			DescriptorLayoutBuilder builder;
-			builder.add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-			_drawImageDescriptorLayout = builder.build(_device, VK_SHADER_STAGE_COMPUTE_BIT);
+		auto start = std::chrono::high_resolution_clock::now();
+
+		//a value of 0 is already reached, that slot has never been submitted
+		VkSemaphoreWaitInfo waitInfo{ .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &_graphicsTimeline;
+		waitInfo.pValues = &frame._timelineValue;
+
+		GEARHEAD_VKSUCCESS_CHECK(vkWaitSemaphores(_device, &waitInfo, FRAME_WAIT_TIMEOUT_NS));
+
+		auto end = std::chrono::high_resolution_clock::now();
+
+		//keep a running average so the numbers are readable in the overlay
+		constexpr float smoothing = 0.05f;
+		//everything this slot staged last time has been copied out
+		_meshUploader.retire(frame._timelineValue);
+		_bindless.retire(frame._timelineValue);
+
+		_frameStats.frameWaitMs = std::chrono::duration<float, std::milli>(end - start).count();
+		_frameStats.avgFrameWaitMs += (_frameStats.frameWaitMs - _frameStats.avgFrameWaitMs) * smoothing;
+
+		if (_lastFrameStart.time_since_epoch().count() != 0) {
+			_frameStats.frameTimeMs = std::chrono::duration<float, std::milli>(start - _lastFrameStart).count();
+			_frameStats.avgFrameTimeMs += (_frameStats.frameTimeMs - _frameStats.avgFrameTimeMs) * smoothing;
+		}
+		_lastFrameStart = start;
+		_frameStats.framesInFlight = _framesInFlight;
+
+		//the slot's last submission is done, so its timestamps are ready without waiting
+		_gpuProfiler.resolve(GetCurrentFrameIndex());
+
+		const GpuFrameTimings& gpuFrame = _gpuProfiler.get_last_frame();
+		if (gpuFrame.frameNumber != _lastResolvedGpuFrame) {
+			_lastResolvedGpuFrame = gpuFrame.frameNumber;
+			_frameStats.gpuFrameMs = (float)_gpuProfiler.get_scope_ms(GPU_SCOPE_DRAW_IMAGE);
+			_frameStats.avgGpuFrameMs += (_frameStats.gpuFrameMs - _frameStats.avgGpuFrameMs) * smoothing;
+			UpdateRenderScale(_frameStats.gpuFrameMs);
 		}
 
-		//allocate a descriptor set for our draw image
-		_drawImageDescriptors = GlobalDescriptorAllocator.allocate(_device, _drawImageDescriptorLayout);
+		GEARHEAD_CORE_LOG_EVERY_N_FRAMES(TRACE, 600, "Frame {0}: cpu {1:.3f} ms, wait {2:.3f} ms, gpu {3:.3f} ms, scale {4:.2f}",
+			_frameNumber, _frameStats.avgFrameTimeMs, _frameStats.avgFrameWaitMs, _frameStats.avgGpuFrameMs, _renderScale);
+
+		_gpuProfiler.begin_frame(GetCurrentFrameIndex(), _frameNumber);
+	}
+
+	void VkWindow::SetRenderScale(float scale)
+	{
+		_renderScaleMode = RenderScaleMode::Fixed;
+		_renderScale = std::clamp(scale, MIN_RENDER_SCALE, 1.f);
+	}
+
+	void VkWindow::SetDynamicRenderScale(float targetGpuFrameMs)
+	{
+		_renderScaleMode = RenderScaleMode::Dynamic;
+		_targetGpuFrameMs = std::max(targetGpuFrameMs, 0.1f);
+	}
 
-		VkDescriptorImageInfo imgInfo{};
-		imgInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-		imgInfo.imageView = _drawImage.imageView;
+	VkExtent2D VkWindow::ScaledDrawExtent(VkExtent2D target) const
+	{
+		//only the part of the draw image covering the target gets rendered, scaled down by the render scale
+		VkExtent2D extent;
+		extent.width = std::max(1U, (uint32_t)(std::min(target.width, _drawImage.imageExtent.width) * _renderScale));
+		extent.height = std::max(1U, (uint32_t)(std::min(target.height, _drawImage.imageExtent.height) * _renderScale));
+		return extent;
+	}
 
-		VkWriteDescriptorSet drawImageWrite = {};
-		drawImageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		drawImageWrite.pNext = nullptr;
+	void VkWindow::UpdateRenderScale(float gpuFrameMs)
+	{
+		if (_renderScaleMode != RenderScaleMode::Dynamic || gpuFrameMs <= 0.f)
+			return;
 
-		drawImageWrite.dstBinding = 0;
-		drawImageWrite.dstSet = _drawImageDescriptors;
-		drawImageWrite.descriptorCount = 1;
-		drawImageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-		drawImageWrite.pImageInfo = &imgInfo;
+		// fill-rate bound work scales with the pixel count, so with scale squared
+		float ideal = _renderScale * std::sqrt(_targetGpuFrameMs / gpuFrameMs);
 
-		vkUpdateDescriptorSets(_device, 1, &drawImageWrite, 0, nullptr);
+		//damped so a single slow frame doesn't make the image pump
+		constexpr float damping = 0.1f;
+		_renderScale += (ideal - _renderScale) * damping;
+		_renderScale = std::clamp(_renderScale, MIN_RENDER_SCALE, 1.f);
+	}
 
-		//make sure both the descriptor allocator and the new layout get cleaned up properly
-		_mainDeletionQueue.push_function([&]() {
-			GlobalDescriptorAllocator.destroy_pool(_device);
+	void VkWindow::SetFramesInFlight(uint32_t count)
+	{
+		count = std::clamp(count, 1U, MAX_FRAMES_IN_FLIGHT);
+		if (count == _framesInFlight)
+			return;
+
+		if (!isInitialized) {
+			_framesInFlight = count;
+			return;
+		}
+
+		GEARHEAD_CORE_INFO("Frames in flight {0} -> {1}", _framesInFlight, count);
 
-			vkDestroyDescriptorSetLayout(_device, _drawImageDescriptorLayout, nullptr);
+		//only happens on a settings change, so a full idle is fine here
+		vkDeviceWaitIdle(_device);
+
+		DestroyFrames();
+		_framesInFlight = count;
+		InitFrames();
+	}
+
+	void VkWindow::InitDescriptors()
+	{
+		//sets that live as long as the renderer, anything rewritten per frame comes from the frame's own allocator
+		GlobalDescriptorAllocator.init(_device, 10, DESCRIPTOR_POOL_RATIOS);
+
+		_mainDeletionQueue.push_function([&]() {
+			GlobalDescriptorAllocator.destroy_pools(_device);
 			});
 
 	}
 
 	void VkWindow::OnUpdate()
 	{
-		glfwPollEvents();
+		{
+			GEARHEAD_PROFILE_SCOPE("Poll Events");
+			glfwPollEvents();
+		}
 
 		if (glfwGetWindowAttrib(_window, GLFW_ICONIFIED)) {
 			isMinimized = true;
@@ -330,13 +702,35 @@ namespace GearHead {
 		
 		if (isMinimized) { std::this_thread::sleep_for(std::chrono::milliseconds(100)); return; }
 
+		BuildImGUI();
+
+		//resizing the frame ring is only safe between frames
+		if (_pendingFramesInFlight != 0) {
+			SetFramesInFlight(_pendingFramesInFlight);
+			_pendingFramesInFlight = 0;
+		}
+
+		if (_swapchainDirty) {
+			_swapchainDirty = false;
+			RebuildSwapChain();
+		}
+
+		DrawFrame();
+
+		SavePipelineCache();
+	}
+
+	void VkWindow::BuildImGUI()
+	{
+		GEARHEAD_PROFILE_FUNCTION();
+
 		ImGui_ImplVulkan_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
 
-		if (ImGui::Begin("Background")) {
+		if (ImGui::Begin("Background") && !backgroundEffects.empty()) {
 			ComputeEffect& selected = backgroundEffects[currentBackgroundEffect];
-			ImGui::Text("Selected Effect: ", selected.name);
+			ImGui::Text("Selected Effect: %s", selected.name);
 
 			ImGui::SliderInt("EffectIndex", &currentBackgroundEffect, 0, backgroundEffects.size() - 1);
 			
@@ -348,84 +742,250 @@ namespace GearHead {
 
 		ImGui::End();
 
+		if (ImGui::Begin("Stats")) {
+			ImGui::Text("Frame time: %.3f ms (avg %.3f ms)", _frameStats.frameTimeMs, _frameStats.avgFrameTimeMs);
+			ImGui::Text("Frame wait: %.3f ms (avg %.3f ms)", _frameStats.frameWaitMs, _frameStats.avgFrameWaitMs);
+
+			int framesInFlight = (int)_framesInFlight;
+			if (ImGui::SliderInt("Frames in flight", &framesInFlight, 1, (int)MAX_FRAMES_IN_FLIGHT)) {
+				_pendingFramesInFlight = (uint32_t)framesInFlight;
+			}
+
+			ImGui::Text("GPU frame: %.3f ms (avg %.3f ms)", _frameStats.gpuFrameMs, _frameStats.avgGpuFrameMs);
+			ImGui::Text("Startup: %.1f ms, pipelines %.1f ms (%s cache)", _startupStats.initMs, _startupStats.pipelineMs,
+				_startupStats.warmPipelineCache ? "warm" : "cold");
+
+			ImGui::Separator();
+			bool dynamicScale = _renderScaleMode == RenderScaleMode::Dynamic;
+			if (ImGui::Checkbox("Dynamic render scale", &dynamicScale)) {
+				dynamicScale ? SetDynamicRenderScale(_targetGpuFrameMs) : SetRenderScale(_renderScale);
+			}
+			if (dynamicScale) {
+				ImGui::SliderFloat("GPU target (ms)", &_targetGpuFrameMs, 1.f, 50.f);
+				ImGui::Text("Render scale: %.2f", _renderScale);
+			}
+			else {
+				float scale = _renderScale;
+				if (ImGui::SliderFloat("Render scale", &scale, MIN_RENDER_SCALE, 1.f)) {
+					SetRenderScale(scale);
+				}
+			}
+			ImGui::Text("Draw extent: %ux%u", _drawExtent.width, _drawExtent.height);
+
+			ImGui::Separator();
+			ImGui::Text("Staging: %.1f / %.1f MB", _meshUploader.staging().used() / 1048576.0, _meshUploader.staging().capacity() / 1048576.0);
+			ImGui::Text("Vertices: %u / %u", _meshUploader.vertex_ranges().used(), _meshUploader.vertex_ranges().capacity());
+			ImGui::Text("Indices: %u / %u", _meshUploader.index_ranges().used(), _meshUploader.index_ranges().capacity());
+			ImGui::Text("Meshlets: %u / %u", _meshUploader.meshlet_ranges().used(), _meshUploader.meshlet_ranges().capacity());
+
+			ImGui::Separator();
+			ImGui::Text("Present mode: %s", PresentModeName(_presentMode));
+			ImGui::Text("Present interval: %.3f ms (avg %.3f ms)", _frameStats.presentIntervalMs, _frameStats.avgPresentIntervalMs);
+			ImGui::PlotLines("##present", _frameStats.presentHistory, FrameStats::HISTORY_SIZE, _frameStats.presentHistoryOffset, nullptr, 0.f, 50.f, ImVec2(0, 60));
+
+			bool vsync = mData.vsync;
+			if (ImGui::Checkbox("VSync", &vsync)) {
+				SetVSync(vsync);
+			}
+
+			bool lowLatency = _lowLatency;
+			if (ImGui::Checkbox("Low latency", &lowLatency)) {
+				SetLowLatency(lowLatency);
+			}
+		}
+
+		ImGui::End();
+
+		if (ImGui::Begin("Scene")) {
+			ImGui::InputText("OBJ path", _importPath, sizeof(_importPath));
+			if (ImGui::Button("Load") && _importPath[0] != '\0') {
+				LoadMeshAsync(_importPath);
+			}
+
+			ImGui::Text("Loading: %zu files", _pendingImports.size());
+			size_t rejected = std::count_if(_sceneMeshes.begin(), _sceneMeshes.end(), [](const ImportedMesh& imported) { return imported.rejected; });
+			ImGui::Text("Meshes: %zu (%zu waiting for upload, %zu rejected)", _sceneMeshes.size(), _meshesAwaitingUpload.size(), rejected);
+			ImGui::Text("Instances: %zu", _sceneInstances.size());
+			ImGui::Checkbox("Frustum culling", &_frustumCulling);
+			ImGui::Checkbox("Occlusion culling", &_occlusionCulling);
+			ImGui::Checkbox("Cluster culling", &_clusterCulling);
+			ImGui::Checkbox("Cluster backface culling", &_backfaceCulling);
+
+			ImGui::Separator();
+			ImGui::SliderFloat("Camera yaw", &_cameraYaw, -180.f, 180.f);
+			ImGui::SliderFloat("Camera pitch", &_cameraPitch, -89.f, 89.f);
+			ImGui::SliderFloat("Camera distance", &_cameraDistance, 0.5f, 10.f);
+		}
+
+		ImGui::End();
+
+		if (ImGui::Begin("GPU Profiler")) {
+			for (const GpuScopeTiming& scope : _gpuProfiler.get_last_frame().scopes) {
+				ImGui::Text("%-12s %7.3f ms  (+%.3f)", scope.name, scope.durationMs, scope.beginMs);
+			}
+
+			ImGui::Separator();
+			if (!_gpuProfiler.is_capturing()) {
+				if (ImGui::Button("Start capture"))
+					_gpuProfiler.start_capture();
+			}
+			else {
+				ImGui::Text("Captured %zu frames", _gpuProfiler.get_captured_frames());
+				if (ImGui::Button("Stop capture"))
+					_gpuProfiler.stop_capture();
+			}
+
+			if (ImGui::Button("Write CSV"))
+				_gpuProfiler.write_csv("GearHead_gpu.csv");
+			ImGui::SameLine();
+			if (ImGui::Button("Write trace"))
+				_gpuProfiler.write_chrome_trace("GearHead_gpu.json");
+
+			//CPU zones and the captured GPU frames on one timeline
+			if (ImGui::Button("Write CPU + GPU trace")) {
+				Profiler::WriteChromeTrace("GearHead_trace.json", [this](std::ostream& out) { _gpuProfiler.append_chrome_events(out); });
+			}
+		}
+
+		ImGui::End();
+
 		//make Imgui calculate internal draw structures
 		ImGui::Render();
-
-		DrawFrame();
 	}
 
 	void VkWindow::DrawFrame()
 	{
-		GEARHEAD_VKSUCCESS_CHECK(vkWaitForFences(_device, 1, &GetCurrentFrame()._renderFence, true, 1000000000));
+		WaitForFrame(GetCurrentFrame());
 
 		GetCurrentFrame()._deletionQueue.flush();
+		GetCurrentFrame()._frameDescriptors.clear_pools(_device);
 
+		PollPipelines();
+		PollMeshImports();
 
-		uint32_t swapchainImageIndex;
-		GEARHEAD_VKSUCCESS_CHECK(vkAcquireNextImageKHR(_device, _swapchain, 1000000000, GetCurrentFrame()._SwapChainSemaphore, nullptr, &swapchainImageIndex));
+		//stretched back up to the swapchain by the blit
+		_drawExtent = ScaledDrawExtent(_swapchainExtent);
 
-		GEARHEAD_VKSUCCESS_CHECK(vkResetFences(_device, 1, &GetCurrentFrame()._renderFence));
+		uint32_t swapchainImageIndex;
+		VkResult acquireResult;
+		{
+			GEARHEAD_PROFILE_SCOPE("Acquire Image");
+			acquireResult = vkAcquireNextImageKHR(_device, _swapchain, FRAME_WAIT_TIMEOUT_NS, GetCurrentFrame()._SwapChainSemaphore, nullptr, &swapchainImageIndex);
+		}
+		if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+			_swapchainDirty = true;
+			return;
+		}
+		if (acquireResult != VK_SUBOPTIMAL_KHR) {
+			GEARHEAD_VKSUCCESS_CHECK(acquireResult);
+		}
 
+		UpdateScene();
 
-		// now that we are sure that the commands finished executing, we can safely
-		// reset the command buffer to begin recording again.
-		GEARHEAD_VKSUCCESS_CHECK(vkResetCommandBuffer(GetCurrentFrame()._buffer, 0));
+		//kick the background effects off before recording graphics so they overlap the tail of the previous frame.
+		//submitted after the acquire so a dropped frame never leaves compute work or timestamps in flight
+		std::optional<VkSemaphoreSubmitInfo> computeWait;
+		if (_asyncCompute) {
+			computeWait = SubmitComputePass();
+		}
 
 		VkCommandBuffer cmd = GetCurrentFrame()._buffer;
 
-		//begin the command buffer recording. We will use this command buffer exactly once, so we want to let vulkan know that
-		VkCommandBufferBeginInfo cmdBeginInfo = VkInit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		{
+			GEARHEAD_PROFILE_SCOPE("Record Commands");
 
+			// now that we are sure that the commands finished executing, we can safely
+			// reset the command buffer to begin recording again.
+			GEARHEAD_VKSUCCESS_CHECK(vkResetCommandBuffer(GetCurrentFrame()._buffer, 0));
 
-		//First Draw
+			//begin the command buffer recording. We will use this command buffer exactly once, so we want to let vulkan know that
+			VkCommandBufferBeginInfo cmdBeginInfo = VkInit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
-		_drawExtent.width = _drawImage.imageExtent.width;
-		_drawExtent.height = _drawImage.imageExtent.height;
 
-		GEARHEAD_VKSUCCESS_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+			//First Draw
 
-		// transition our main draw image into general layout so we can write into it
-		// we will overwrite it all so we dont care about what was the older layout
-		VkUtil::transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+			GEARHEAD_VKSUCCESS_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
 
-		DrawBackground(cmd);
+			//every mesh uploaded since the last frame, in one batch
+			if (_meshUploader.has_pending()) {
+				uint32_t uploadScope = _gpuProfiler.begin_scope(cmd, "Upload");
+				_meshUploader.record(cmd);
+				_gpuProfiler.end_scope(cmd, uploadScope);
+			}
 
-		//transition the draw image and the swapchain image into their correct transfer layouts
-		VkUtil::transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-		VkUtil::transition_image(cmd, _swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+			//with async compute the frame starts on the compute queue instead
+			if (!_asyncCompute) {
+				_drawImageScope = _gpuProfiler.begin_scope(cmd, GPU_SCOPE_DRAW_IMAGE);
+			}
 
-		// End First Draw
+			DrawScene(cmd);
 
-		//ImGUI Draw
+			//stop before the swapchain work, so waiting on vblank doesn't count as draw image time
+			_gpuProfiler.end_scope(cmd, _drawImageScope);
 
+			//transition the draw image and the swapchain image into their correct transfer layouts
+			uint32_t transitionScope = _gpuProfiler.begin_scope(cmd, "Transitions");
+			VkUtil::transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+			VkUtil::transition_image(cmd, _swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+			_gpuProfiler.end_scope(cmd, transitionScope);
 
-			// execute a copy from the draw image into the swapchain
-		VkUtil::copy_image_to_image(cmd, _drawImage.image, _swapchainImages[swapchainImageIndex], _drawExtent, _swapchainExtent);
+			// End First Draw
 
-		// set swapchain image layout to Attachment Optimal so we can draw it
-		VkUtil::transition_image(cmd, _swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+			//ImGUI Draw
 
-		//draw imgui into the swapchain image
-		DrawImGUI(cmd, _swapchainImageViews[swapchainImageIndex]);
 
-		// set swapchain image layout to Present so we can draw it
-		VkUtil::transition_image(cmd, _swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+				// execute a copy from the draw image into the swapchain
+			uint32_t blitScope = _gpuProfiler.begin_scope(cmd, "Blit");
+			VkUtil::copy_image_to_image(cmd, _drawImage.image, _swapchainImages[swapchainImageIndex], _drawExtent, _swapchainExtent);
+			_gpuProfiler.end_scope(cmd, blitScope);
 
-		//finalize the command buffer (we can no longer add commands, but it can now be executed)
-		GEARHEAD_VKSUCCESS_CHECK(vkEndCommandBuffer(cmd));
+			uint32_t imguiScope = _gpuProfiler.begin_scope(cmd, "ImGUI");
+
+			// set swapchain image layout to Attachment Optimal so we can draw it
+			VkUtil::transition_image(cmd, _swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+			//draw imgui into the swapchain image
+			DrawImGUI(cmd, _swapchainImageViews[swapchainImageIndex]);
+
+			// set swapchain image layout to Present so we can draw it
+			VkUtil::transition_image(cmd, _swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+			_gpuProfiler.end_scope(cmd, imguiScope);
+
+			//finalize the command buffer (we can no longer add commands, but it can now be executed)
+			GEARHEAD_VKSUCCESS_CHECK(vkEndCommandBuffer(cmd));
+		}
 
 		//End ImGUI Draw
 
 		VkCommandBufferSubmitInfo cmdinfo = VkInit::command_buffer_submit_info(cmd);
 
-		VkSemaphoreSubmitInfo waitInfo = VkInit::semaphore_submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, GetCurrentFrame()._SwapChainSemaphore);
-		VkSemaphoreSubmitInfo signalInfo = VkInit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, GetCurrentFrame()._renderSemaphore);
+		VkSemaphoreSubmitInfo waitInfos[2];
+		uint32_t waitCount = 0;
+		waitInfos[waitCount++] = VkInit::semaphore_submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, GetCurrentFrame()._SwapChainSemaphore);
+		if (computeWait) {
+			waitInfos[waitCount++] = *computeWait;
+		}
 
-		VkSubmitInfo2 submit = VkInit::submit_info(&cmdinfo, &signalInfo, &waitInfo);
+		// the blit timeline only needs the copy out of the draw image to be done, not the ImGUI pass
+		GetCurrentFrame()._timelineValue = ++_graphicsTimelineValue;
+		_meshUploader.submit(_graphicsTimelineValue);
+		_bindless.submit(_graphicsTimelineValue);
+		VkSemaphoreSubmitInfo signalInfos[] = {
+			VkInit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, GetCurrentFrame()._renderSemaphore),
+			VkInit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _graphicsTimeline, _graphicsTimelineValue),
+			//compute too, the next cull pass reads the depth pyramid built before the blit, and copy for the meshlets it reads
+			VkInit::semaphore_submit_info(VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT, _blitTimeline, ++_blitTimelineValue)
+		};
+
+		VkSubmitInfo2 submit = VkInit::submit_info(&cmdinfo, signalInfos, std::span(waitInfos, waitCount));
 
 		//submit command buffer to the queue and execute it.
-		// _renderFence will now block until the graphic commands finish execution
-		GEARHEAD_VKSUCCESS_CHECK(vkQueueSubmit2(_graphicsQueue, 1, &submit, GetCurrentFrame()._renderFence));
+		// the graphics timeline reaches this frame's value once the graphic commands finish execution
+		{
+			GEARHEAD_PROFILE_SCOPE("Submit");
+			GEARHEAD_VKSUCCESS_CHECK(vkQueueSubmit2(_graphicsQueue, 1, &submit, VK_NULL_HANDLE));
+		}
 		
 		//prepare present
 		// this will put the image we just rendered to into the visible window.
@@ -442,9 +1002,25 @@ namespace GearHead {
 
 		presentInfo.pImageIndices = &swapchainImageIndex;
 
-		if (vkQueuePresentKHR(_graphicsQueue, &presentInfo) == VK_ERROR_OUT_OF_DATE_KHR) {
-			RebuildSwapChain();
-			return;
+		VkResult presentResult;
+		{
+			GEARHEAD_PROFILE_SCOPE("Present");
+			presentResult = vkQueuePresentKHR(_graphicsQueue, &presentInfo);
+		}
+
+		//present-to-present interval, how often frames actually reach the display queue
+		auto presentTime = std::chrono::high_resolution_clock::now();
+		if (_lastPresent.time_since_epoch().count() != 0) {
+			_frameStats.presentIntervalMs = std::chrono::duration<float, std::milli>(presentTime - _lastPresent).count();
+			_frameStats.avgPresentIntervalMs += (_frameStats.presentIntervalMs - _frameStats.avgPresentIntervalMs) * 0.05f;
+			_frameStats.presentHistory[_frameStats.presentHistoryOffset] = _frameStats.presentIntervalMs;
+			_frameStats.presentHistoryOffset = (_frameStats.presentHistoryOffset + 1) % FrameStats::HISTORY_SIZE;
+		}
+		_lastPresent = presentTime;
+
+		//rebuilt between frames by OnUpdate, nothing here waits on the gpu
+		if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR) {
+			_swapchainDirty = true;
 		}
 
 		//increase the number of frames drawn
@@ -452,21 +1028,367 @@ namespace GearHead {
 
 	}
 
+	void VkWindow::DrawScene(VkCommandBuffer cmd)
+	{
+		//with async compute the background was already recorded on the compute queue
+		if (!_asyncCompute) {
+			RecordComputePass(cmd);
+		}
+
+		//the background leaves the draw image in general, geometry goes on top of it
+		VkUtil::transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		VkUtil::transition_image(cmd, _depthImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
+		DrawGeometry(cmd);
+
+		//what the next frame culls against
+		BuildDepthPyramid(cmd);
+	}
+
+	void VkWindow::RecordComputePass(VkCommandBuffer cmd)
+	{
+		// transition our main draw image into general layout so we can write into it
+		// we will overwrite it all so we dont care about what was the older layout
+		uint32_t scope = _gpuProfiler.begin_scope(cmd, "Background");
+
+		VkUtil::transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+		DrawBackground(cmd);
+
+		_gpuProfiler.end_scope(cmd, scope);
+
+		CullScene(cmd);
+	}
+
+	VkSemaphoreSubmitInfo VkWindow::SubmitComputePass()
+	{
+		GEARHEAD_PROFILE_FUNCTION();
+
+		VkCommandBuffer cmd = GetCurrentFrame()._computeBuffer;
+
+		// the frame wait at the top of DrawFrame covers this buffer, graphics never finishes before the compute it waits on
+		GEARHEAD_VKSUCCESS_CHECK(vkResetCommandBuffer(cmd, 0));
+
+		VkCommandBufferBeginInfo cmdBeginInfo = VkInit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		GEARHEAD_VKSUCCESS_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+		_drawImageScope = _gpuProfiler.begin_scope(cmd, GPU_SCOPE_DRAW_IMAGE);
+
+		RecordComputePass(cmd);
+
+		GEARHEAD_VKSUCCESS_CHECK(vkEndCommandBuffer(cmd));
+
+		VkCommandBufferSubmitInfo cmdinfo = VkInit::command_buffer_submit_info(cmd);
+
+		// don't overwrite the draw image until the previous frame has blitted it out
+		VkSemaphoreSubmitInfo waitInfo = VkInit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _blitTimeline, _blitTimelineValue);
+		VkSemaphoreSubmitInfo signalInfo = VkInit::semaphore_submit_info(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, _computeTimeline, ++_computeTimelineValue);
+
+		VkSubmitInfo2 submit = VkInit::submit_info(&cmdinfo, &signalInfo, &waitInfo);
+
+		GEARHEAD_VKSUCCESS_CHECK(vkQueueSubmit2(_computeQueue, 1, &submit, VK_NULL_HANDLE));
+
+		return VkInit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _computeTimeline, _computeTimelineValue);
+	}
+
 	void VkWindow::DrawBackground(VkCommandBuffer cmd)
 	{
+		//placeholder until the effect (or its fallback) has compiled, a flat clear instead of holding the frame
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		if (!backgroundEffects.empty()) {
+			pipeline = _pipelineCompiler.get(backgroundEffects[currentBackgroundEffect].pipeline);
+		}
+		if (pipeline == VK_NULL_HANDLE) {
+			VkClearColorValue clearValue = { { 0.1f, 0.1f, 0.1f, 1.f } };
+			VkImageSubresourceRange clearRange = VkInit::image_subresource_range(VK_IMAGE_ASPECT_COLOR_BIT);
+			vkCmdClearColorImage(cmd, _drawImage.image, VK_IMAGE_LAYOUT_GENERAL, &clearValue, 1, &clearRange);
+			return;
+		}
+
 		ComputeEffect& effect = backgroundEffects[currentBackgroundEffect];
+		VkPipelineLayout layout = effect.layout->pipelineLayout;
+
 		// bind the background effect pipeling
-		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, effect.pipeline);
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
 
-		// bind the descriptor set containing the draw image for the compute pipeline
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _gradientPipelineLayout, 0, 1, &_drawImageDescriptors, 0, nullptr);
+		// the bindless set has the draw image along with everything else, effects find it through the push constants
+		VkDescriptorSet bindlessSet = _bindless.set();
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout, BINDLESS_SET, 1, &bindlessSet, 0, nullptr);
 
-		vkCmdPushConstants(cmd, _gradientPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &effect.data);
-		// execute the compute pipeline dispatch. We are using 16x16 workgroup size so we need to divide by it
-		vkCmdDispatch(cmd, std::ceil(_drawExtent.width / 16.0), std::ceil(_drawExtent.height / 16.0), 1);
+		vkCmdPushConstants(cmd, layout, effect.layout->pushConstantStages, 0, sizeof(ComputePushConstants), &effect.data);
+
+		// the draw image is bigger than what we render, effects use this instead of imageSize()
+		BackgroundPushConstants frameData{ .drawExtent = glm::ivec2(_drawExtent.width, _drawExtent.height), .drawImageIndex = _drawImageIndex };
+		vkCmdPushConstants(cmd, layout, effect.layout->pushConstantStages, sizeof(ComputePushConstants), sizeof(BackgroundPushConstants), &frameData);
+		// one invocation per pixel, in whatever workgroup size the effect declares
+		vkCmdDispatch(cmd, (_drawExtent.width + effect.localSize[0] - 1) / effect.localSize[0], (_drawExtent.height + effect.localSize[1] - 1) / effect.localSize[1], 1);
 
 	}
 
+	void VkWindow::UpdateScene()
+	{
+		GEARHEAD_PROFILE_FUNCTION();
+
+		//only walks the meshes when one was uploaded or freed, a static scene costs nothing per instance here
+		if (_sceneDirty) {
+			_sceneDirty = false;
+			_sceneVersion++;
+			_sceneInstances.clear();
+
+			glm::vec3 sceneMin(std::numeric_limits<float>::max());
+			glm::vec3 sceneMax(std::numeric_limits<float>::lowest());
+			for (const ImportedMesh& imported : _sceneMeshes) {
+				const Mesh& mesh = imported.mesh;
+				if (!mesh._allocation.valid())
+					continue;
+
+				//indirect draws are indexed only, every importer writes indices
+				if (mesh._allocation.indexCount == 0) {
+					GEARHEAD_CORE_LOG_RATE_LIMITED(WARN, 1000, "Mesh without indices left out of the scene");
+					continue;
+				}
+
+				if (_sceneInstances.size() == MAX_SCENE_INSTANCES) {
+					GEARHEAD_CORE_LOG_RATE_LIMITED(WARN, 1000, "More than {0} meshes in the scene, the rest are skipped", MAX_SCENE_INSTANCES);
+					break;
+				}
+
+				GPUInstance instance{};
+				instance.model = glm::mat4(1.f);
+				instance.boundingSphere = glm::vec4(mesh._bounds.sphereCenter, mesh._bounds.sphereRadius);
+				instance.indexCount = mesh._allocation.indexCount;
+				instance.firstIndex = mesh._allocation.firstIndex;
+				instance.vertexOffset = (int32_t)mesh._allocation.firstVertex;
+				//an async cull pass runs ahead of this frame's copies, meshlets uploaded since the last frame aren't there yet.
+				//Until they are the mesh is drawn whole and the scene is rebuilt again next frame
+				if (mesh._allocation.meshletCount > 0 && _asyncCompute && mesh._allocation.uploadBatch > _meshUploader.recorded_batches()) {
+					_sceneDirty = true;
+				}
+				else {
+					instance.firstMeshlet = mesh._allocation.firstMeshlet;
+					instance.meshletCount = mesh._allocation.meshletCount;
+				}
+				_sceneInstances.push_back(instance);
+
+				sceneMin = glm::min(sceneMin, mesh._bounds.min);
+				sceneMax = glm::max(sceneMax, mesh._bounds.max);
+			}
+
+			if (!_sceneInstances.empty()) {
+				_sceneCenter = (sceneMin + sceneMax) * 0.5f;
+				_sceneRadius = std::max(glm::length(sceneMax - sceneMin) * 0.5f, 0.001f);
+			}
+		}
+
+		FrameData& frame = GetCurrentFrame();
+
+		//this slot's last submission is done, nothing reads the old instances any more
+		if (frame._instanceVersion != _sceneVersion) {
+			frame._instanceVersion = _sceneVersion;
+			if (!_sceneInstances.empty()) {
+				memcpy(frame._instanceBuffer.mapped(), _sceneInstances.data(), _sceneInstances.size() * sizeof(GPUInstance));
+			}
+		}
+
+		//orbits the bounds of everything uploaded so far
+		float yaw = glm::radians(_cameraYaw);
+		float pitch = glm::radians(_cameraPitch);
+		glm::vec3 eye = _sceneCenter + glm::vec3(cos(pitch) * sin(yaw), sin(pitch), cos(pitch) * cos(yaw)) * _sceneRadius * _cameraDistance;
+
+		float znear = _sceneRadius * 0.01f;
+		float zfar = _sceneRadius * 100.f;
+		glm::mat4 view = glm::lookAt(eye, _sceneCenter, glm::vec3(0.f, 1.f, 0.f));
+		//near and far swapped for reverse z
+		glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(70.f), (float)_drawExtent.width / (float)_drawExtent.height, zfar, znear);
+		//flip y, vulkan clip space points down
+		projection[1][1] *= -1;
+
+		_sceneViewProj = projection * view;
+		_sceneView.view = view;
+		_sceneView.projection = glm::vec4(projection[0][0], projection[1][1], projection[2][2], projection[3][2]);
+		_sceneView.znear = znear;
+		_sceneView.zfar = zfar;
+
+		GPUCullData& cullData = *frame._cullDataBuffer.mapped_as<GPUCullData>();
+		cullData.view = _sceneView;
+		cullData.pyramidView = _depthPyramidView;
+		cullData.pyramidExtent = glm::uvec2(_depthPyramidExtent.width, _depthPyramidExtent.height);
+		cullData.pyramidIndex = _depthPyramidIndex;
+		cullData.pyramidLevels = DepthPyramidLevels(_depthPyramidExtent);
+		cullData.instanceCount = (uint32_t)_sceneInstances.size();
+		cullData.flags = 0;
+		if (_frustumCulling)
+			cullData.flags |= CULL_FRUSTUM;
+		if (_occlusionCulling && _depthPyramidValid)
+			cullData.flags |= CULL_OCCLUSION;
+		if (_clusterCulling)
+			cullData.flags |= CULL_CLUSTERS;
+		if (_clusterCulling && _backfaceCulling)
+			cullData.flags |= CULL_BACKFACE;
+		cullData.maxDraws = MAX_SCENE_DRAWS;
+	}
+
+	void VkWindow::CullScene(VkCommandBuffer cmd)
+	{
+		_sceneCulled = false;
+
+		VkPipeline pipeline = _pipelineCompiler.get(_cullPipeline);
+		if (_sceneInstances.empty() || pipeline == VK_NULL_HANDLE || !_cullLayout)
+			return;
+
+		uint32_t scope = _gpuProfiler.begin_scope(cmd, "Cull");
+
+		FrameData& frame = GetCurrentFrame();
+
+		//on a single queue the last frame's pyramid build can still be running
+		VkUtil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+
+		vkCmdFillBuffer(cmd, frame._drawCountBuffer._buffer, 0, sizeof(uint32_t), 0);
+		//no cluster workgroups until the instance pass queues some
+		GPUClusterWork clusterWork{ .dispatch = { 0, 1, 1 }, .queued = 0 };
+		vkCmdUpdateBuffer(cmd, frame._clusterWorkBuffer._buffer, 0, sizeof(GPUClusterWork), &clusterWork);
+		VkUtil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+		//the depth pyramid is a slot in the sampled image table
+		VkDescriptorSet bindlessSet = _bindless.set();
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullLayout->pipelineLayout, BINDLESS_SET, 1, &bindlessSet, 0, nullptr);
+
+		GPUCullPushConstants pushConstants;
+		pushConstants.cullData = frame._cullDataBuffer._address;
+		pushConstants.instances = frame._instanceBuffer._address;
+		pushConstants.meshlets = _meshUploader.meshlet_address();
+		pushConstants.clusterWork = frame._clusterWorkBuffer._address;
+		pushConstants.drawCommands = frame._drawCommandBuffer._address;
+		pushConstants.drawCount = frame._drawCountBuffer._address;
+		pushConstants.pass = CULL_PASS_INSTANCES;
+		vkCmdPushConstants(cmd, _cullLayout->pipelineLayout, _cullLayout->pushConstantStages, 0, sizeof(GPUCullPushConstants), &pushConstants);
+
+		uint32_t instanceCount = (uint32_t)_sceneInstances.size();
+		vkCmdDispatch(cmd, (instanceCount + _cullLocalSize[0] - 1) / _cullLocalSize[0], 1, 1);
+
+		//the cluster pass reads the queued instances and is launched with the workgroup count the instance pass wrote
+		VkUtil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+
+		pushConstants.pass = CULL_PASS_CLUSTERS;
+		vkCmdPushConstants(cmd, _cullLayout->pipelineLayout, _cullLayout->pushConstantStages, 0, sizeof(GPUCullPushConstants), &pushConstants);
+		vkCmdDispatchIndirect(cmd, frame._clusterWorkBuffer._buffer, 0);
+
+		//with async compute the semaphore wait covers the other queue, this covers the single queue case
+		VkUtil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+
+		_gpuProfiler.end_scope(cmd, scope);
+
+		_sceneCulled = true;
+	}
+
+	void VkWindow::DrawGeometry(VkCommandBuffer cmd)
+	{
+		uint32_t scope = _gpuProfiler.begin_scope(cmd, "Geometry");
+
+		VkRenderingAttachmentInfo colorAttachment = VkInit::attachment_info(_drawImage.imageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		VkRenderingAttachmentInfo depthAttachment = VkInit::depth_attachment_info(_depthImage.imageView, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
+		VkRenderingInfo renderInfo = VkInit::rendering_info(_drawExtent, &colorAttachment, &depthAttachment);
+		vkCmdBeginRendering(cmd, &renderInfo);
+
+		//meshes show up once their pipeline has compiled and the cull pass has written draws for them
+		VkPipeline meshPipeline = _pipelineCompiler.get(_meshPipeline);
+		if (_sceneCulled && meshPipeline != VK_NULL_HANDLE && _meshLayout) {
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, meshPipeline);
+
+			//the draw image is bigger than what we render, only the draw extent is covered
+			VkViewport viewport = {};
+			viewport.x = 0;
+			viewport.y = 0;
+			viewport.width = (float)_drawExtent.width;
+			viewport.height = (float)_drawExtent.height;
+			viewport.minDepth = 0.f;
+			viewport.maxDepth = 1.f;
+			vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+			VkRect2D scissor = {};
+			scissor.offset = { 0, 0 };
+			scissor.extent = _drawExtent;
+			vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+			//every mesh lives in the same buffers, the vertex shader pulls from them by address so only indices get bound
+			vkCmdBindIndexBuffer(cmd, _meshUploader.index_buffer(), 0, VK_INDEX_TYPE_UINT32);
+
+			//one push for the whole pass, everything per draw comes out of the instance buffer
+			FrameData& frame = GetCurrentFrame();
+			GPUDrawPushConstants pushConstants;
+			pushConstants.viewProj = _sceneViewProj;
+			pushConstants.positions = _meshUploader.vertex_address(0);
+			pushConstants.attributes = _meshUploader.vertex_address(1);
+			pushConstants.instances = frame._instanceBuffer._address;
+			vkCmdPushConstants(cmd, _meshLayout->pipelineLayout, _meshLayout->pushConstantStages, 0, sizeof(GPUDrawPushConstants), &pushConstants);
+
+			//one call however many instances there are, the GPU reads how many survived culling from the count buffer
+			vkCmdDrawIndexedIndirectCount(cmd, frame._drawCommandBuffer._buffer, 0, frame._drawCountBuffer._buffer, 0,
+				MAX_SCENE_DRAWS, sizeof(VkDrawIndexedIndirectCommand));
+		}
+
+		vkCmdEndRendering(cmd);
+
+		_gpuProfiler.end_scope(cmd, scope);
+	}
+
+	void VkWindow::BuildDepthPyramid(VkCommandBuffer cmd)
+	{
+		VkPipeline pipeline = _pipelineCompiler.get(_depthPyramidPipeline);
+		if (pipeline == VK_NULL_HANDLE || !_depthPyramidLayout) {
+			_depthPyramidValid = false;
+			return;
+		}
+
+		uint32_t scope = _gpuProfiler.begin_scope(cmd, "Depth Pyramid");
+
+		VkUtil::transition_image(cmd, _depthImage.image, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+		//every level gets rewritten, this frame's cull pass was the last to read the old contents
+		VkUtil::transition_image(cmd, _depthPyramid.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+		VkDescriptorSet bindlessSet = _bindless.set();
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _depthPyramidLayout->pipelineLayout, BINDLESS_SET, 1, &bindlessSet, 0, nullptr);
+
+		//only the draw extent, the rest of the depth image is left over from bigger frames
+		uint32_t levels = DepthPyramidLevels(_drawExtent);
+		DepthPyramidPushConstants pushConstants;
+		pushConstants.srcSize = glm::ivec2(_drawExtent.width, _drawExtent.height);
+		pushConstants.srcIndex = _depthImageIndex;
+
+		for (uint32_t level = 0; level < levels; level++) {
+			pushConstants.dstSize = (pushConstants.srcSize + 1) / 2;
+			pushConstants.dstIndex = _depthPyramidStorageIndices[level];
+			vkCmdPushConstants(cmd, _depthPyramidLayout->pipelineLayout, _depthPyramidLayout->pushConstantStages, 0, sizeof(DepthPyramidPushConstants), &pushConstants);
+
+			vkCmdDispatch(cmd, (pushConstants.dstSize.x + _depthPyramidLocalSize[0] - 1) / _depthPyramidLocalSize[0],
+				(pushConstants.dstSize.y + _depthPyramidLocalSize[1] - 1) / _depthPyramidLocalSize[1], 1);
+
+			//the next level reads this one back
+			VkUtil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+
+			pushConstants.srcSize = pushConstants.dstSize;
+			pushConstants.srcIndex = _depthPyramidSampledIndices[level];
+		}
+
+		_gpuProfiler.end_scope(cmd, scope);
+
+		//the next frame culls against this, seen from this frame's camera
+		_depthPyramidView = _sceneView;
+		_depthPyramidExtent = _drawExtent;
+		_depthPyramidValid = true;
+	}
+
 	void VkWindow::DrawImGUI(VkCommandBuffer cmd, VkImageView targetImageView) const
 	{
 		VkRenderingAttachmentInfo colorAttachment = VkInit::attachment_info(targetImageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
@@ -483,15 +1405,19 @@ namespace GearHead {
 	{
 		vkb::SwapchainBuilder swapchainBuilder{ _chosenGPU,_device,_surface };
 
+		_presentMode = ChoosePresentMode();
+
 		_swapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
 
 		vkb::Swapchain vkbSwapchain = swapchainBuilder
 			//.use_default_format_selection()
 			.set_desired_format(VkSurfaceFormatKHR{ .format = _swapchainImageFormat, .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR })
-			//use vsync present mode
-			.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
+			.set_desired_present_mode(_presentMode)
+			.set_desired_min_image_count(DesiredSwapchainImageCount())
 			.set_desired_extent(width, height)
 			.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+			//hand the current swapchain over so the driver can recycle its images
+			.set_old_swapchain(_swapchain)
 			.build()
 			.value();
 
@@ -515,153 +1441,229 @@ namespace GearHead {
 
 	void VkWindow::RebuildSwapChain()
 	{
-		vkQueueWaitIdle(_graphicsQueue);
-
-		vkb::SwapchainBuilder swapchainBuilder{ _chosenGPU,_device,_surface };
-		glfwGetFramebufferSize(_window, (int*)&mData.props.Width, (int*)&mData.props.Height);
-
-		vkDestroySwapchainKHR(_device, _swapchain, nullptr);
-		vkDestroyImageView(_device, _drawImage.imageView, nullptr);
-		vmaDestroyImage(_allocator, _drawImage.image, _drawImage.allocation);
+		int width = 0, height = 0;
+		glfwGetFramebufferSize(_window, &width, &height);
 
-		vkb::Swapchain vkbSwapchain = swapchainBuilder
-			.use_default_format_selection()
-			//use vsync present mode
-			.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
-			.set_desired_extent(mData.props.Width, mData.props.Height)
-			.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-			.build()
-			.value();
+		//minimized, try again once there is something to draw to
+		if (width == 0 || height == 0) {
+			_swapchainDirty = true;
+			return;
+		}
 
-		//store swapchain and its related images
-		_swapchain = vkbSwapchain.swapchain;
-		_swapchainImages = vkbSwapchain.get_images().value();
-		_swapchainImageViews = vkbSwapchain.get_image_views().value();
+		mData.props.Width = (unsigned int)width;
+		mData.props.Height = (unsigned int)height;
 
-		_swapchainImageFormat = vkbSwapchain.image_format;
+		VkSwapchainKHR oldSwapchain = _swapchain;
+		std::vector<VkImageView> oldImageViews = _swapchainImageViews;
 
-		//depth image size will match the window
-		VkExtent3D drawImageExtent = {
-			mData.props.Width,
-			mData.props.Height,
-			1
-		};
+		CreateSwapChain(mData.props.Width, mData.props.Height);
 
-		//hardcoding the depth format to 32 bit float
-		_drawImage.imageFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+		// frames that are still in flight may be using the retired swapchain. Hand it to the most recently
+		// submitted frame, its queue is flushed once that frame is done so nothing waits on the gpu here
+		GetPreviousFrame()._deletionQueue.push_function([=]() {
+			for (VkImageView view : oldImageViews) {
+				vkDestroyImageView(_device, view, nullptr);
+			}
+			vkDestroySwapchainKHR(_device, oldSwapchain, nullptr);
+			});
 
-		VkImageUsageFlags drawImageUsages{};
-		drawImageUsages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-		drawImageUsages |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-		drawImageUsages |= VK_IMAGE_USAGE_STORAGE_BIT;
+		GrowDrawImage(_swapchainExtent);
 
-		VkImageCreateInfo rimg_info = VkInit::image_create_info(_drawImage.imageFormat, drawImageUsages, drawImageExtent);
+		//low latency changes the image count along with the present mode
+		ImGui_ImplVulkan_SetMinImageCount(DesiredSwapchainImageCount());
+	}
 
-		//for the draw image, we want to allocate it from gpu local memory
-		VmaAllocationCreateInfo rimg_allocinfo = {};
-		rimg_allocinfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-		rimg_allocinfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	void VkWindow::InitPipelineCache()
+	{
+		_pipelineCache.init(_device, _chosenGPU, PIPELINE_CACHE_PATH);
+		_startupStats.warmPipelineCache = _pipelineCache.is_warm();
+		_lastPipelineCacheSave = std::chrono::high_resolution_clock::now();
 
-		//allocate and create the image
-		vmaCreateImage(_allocator, &rimg_info, &rimg_allocinfo, &_drawImage.image, &_drawImage.allocation, nullptr);
+		//pushed before any pipeline, so it's flushed after all of them and picks up everything they compiled
+		_mainDeletionQueue.push_function([=]() {
+			_pipelineCache.save();
+			_pipelineCache.destroy();
+			});
+	}
 
-		//build a image-view for the draw image to use for rendering
-		VkImageViewCreateInfo rview_info = VkInit::imageview_create_info(_drawImage.imageFormat, _drawImage.image, VK_IMAGE_ASPECT_COLOR_BIT);
+	void VkWindow::SavePipelineCache()
+	{
+		auto now = std::chrono::high_resolution_clock::now();
+		if (now - _lastPipelineCacheSave < PIPELINE_CACHE_SAVE_INTERVAL)
+			return;
 
-		GEARHEAD_VKSUCCESS_CHECK(vkCreateImageView(_device, &rview_info, nullptr, &_drawImage.imageView));
-		/* For Later
-		VkDescriptorImageInfo imgInfo{};
-		imgInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-		imgInfo.imageView = _drawImage.imageView;
+		//so a crash doesn't throw away pipelines compiled since startup
+		_lastPipelineCacheSave = now;
+		_pipelineCache.save_async();
+	}
 
-		VkWriteDescriptorSet cameraWrite = VkInit::write_descriptor_image(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, _drawImageDescriptors, &imgInfo, 0);
+	void VkWindow::InitPipelines()
+	{
+		_shaderRegistry.init(_device);
+		_layoutCache.init(_device);
+		_layoutCache.reserve_set(BINDLESS_SET, _bindless.layout(), _bindless.binding_types());
+		//destroyed after the compiler, which still loads from them until everything in flight is done
+		_mainDeletionQueue.push_function([=]() {
+			_layoutCache.destroy();
+			_shaderRegistry.destroy();
+			});
 
-		vkUpdateDescriptorSets(_device, 1, &cameraWrite, 0, nullptr);
-		*/
+		_pipelineCompiler.init(_device, _pipelineCache.get(), _shaderRegistry);
 
+		InitBackgroundPipelines();
+		InitMeshPipeline();
+		InitCullPipelines();
 
-		//add to deletion queues
-		_mainDeletionQueue.push_function([&]() {
-			vkDestroyImageView(_device, _drawImage.imageView, nullptr);
-			vmaDestroyImage(_allocator, _drawImage.image, _drawImage.allocation);
-			});
+		GEARHEAD_CORE_INFO("Queued {0} pipelines from {1} shader modules and {2} layouts ({3} cache, {4} bytes loaded)", _pipelineCompiler.pending(),
+			_shaderRegistry.module_count(), _layoutCache.pipeline_layout_count(), _startupStats.warmPipelineCache ? "warm" : "cold", _pipelineCache.loaded_size());
 
+		//pushed after the layout cache, so nothing is still compiling against a layout when it gets destroyed
+		_mainDeletionQueue.push_function([=]() { _pipelineCompiler.destroy(); });
 	}
 
-	void VkWindow::InitPipelines()
+	void VkWindow::InitShaderHotReload()
 	{
-		InitBackgroundPipelines();
+#ifdef GEARHEAD_SHADER_HOT_RELOAD
+		//rebuilt straight into the directory the pipelines load from
+		if (_shaderReloader.init(GEARHEAD_SHADER_SOURCE_DIR, "./Shaders", GEARHEAD_GLSL_VALIDATOR)) {
+			_mainDeletionQueue.push_function([=]() { _shaderReloader.destroy(); });
+		}
+#endif
 	}
 
-	void VkWindow::InitBackgroundPipelines()
+	void VkWindow::PollPipelines(bool wait)
 	{
-		VkPipelineLayoutCreateInfo computeLayout{};
-		computeLayout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		computeLayout.pNext = nullptr;
-		computeLayout.pSetLayouts = &_drawImageDescriptorLayout;
-		computeLayout.setLayoutCount = 1;
-
-		VkPushConstantRange pushConstant{};
-		pushConstant.offset = 0;
-		pushConstant.size = sizeof(ComputePushConstants);
-		pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-		computeLayout.pPushConstantRanges = &pushConstant;
-		computeLayout.pushConstantRangeCount = 1;
+		for (const std::string& spvPath : _shaderReloader.poll()) {
+			_pipelineCompiler.recompile_shader(spvPath);
+		}
 
-		GEARHEAD_VKSUCCESS_CHECK(vkCreatePipelineLayout(_device, &computeLayout, nullptr, &_gradientPipelineLayout));
+		bool wasPending = _pipelineCompiler.pending() > 0;
 
-		VkShaderModule gradientShader;
-		if (!VkUtil::load_shader_module("./Shaders/Gradient.comp.spv", _device, &gradientShader))
-		{
-			GEARHEAD_CORE_ERROR("Failed to load ./Shaders/Gradient.comp.spv");
+		if (wait) {
+			_pipelineCompiler.wait_all();
 		}
-
-		VkShaderModule skyShader;
-		if (!VkUtil::load_shader_module("./Shaders/sky.comp.spv", _device, &skyShader)) {
-			GEARHEAD_CORE_ERROR("failed to load ./Shaders/sky.comp.spv");
+		else {
+			_pipelineCompiler.poll();
 		}
 
-		VkPipelineShaderStageCreateInfo stageinfo{};
-		stageinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		stageinfo.pNext = nullptr;
-		stageinfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-		stageinfo.module = gradientShader;
-		stageinfo.pName = "main";
+		//the frames that could still be using a replaced pipeline are done by the time this slot comes around again
+		for (VkPipeline retired : _pipelineCompiler.take_retired()) {
+			GetCurrentFrame()._deletionQueue.push_function([=]() { vkDestroyPipeline(_device, retired, nullptr); });
+		}
 
-		VkComputePipelineCreateInfo computePipelineCreateInfo{};
-		computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-		computePipelineCreateInfo.pNext = nullptr;
-		computePipelineCreateInfo.layout = _gradientPipelineLayout;
-		computePipelineCreateInfo.stage = stageinfo;
+		if (wasPending && _pipelineCompiler.pending() == 0) {
+			if (_startupStats.pipelineMs == 0.f) {
+				_startupStats.pipelineMs = _pipelineCompiler.batch_ms();
+				GEARHEAD_CORE_INFO("Pipelines ready in {0:.2f} ms ({1} cache)", _startupStats.pipelineMs,
+					_startupStats.warmPipelineCache ? "warm" : "cold");
+			}
+			else {
+				GEARHEAD_CORE_INFO("Pipelines rebuilt in {0:.2f} ms", _pipelineCompiler.batch_ms());
+			}
+		}
+	}
 
-		ComputeEffect gradient = { .name = "gradient",.layout = _gradientPipelineLayout, .data = {} };
+	void VkWindow::InitBackgroundPipelines()
+	{
+		ComputePushConstants gradientData{};
+		gradientData.data1 = glm::vec4(1, 0, 0, 1);
+		gradientData.data2 = glm::vec4(0, 0, 1, 1);
 
-		gradient.data.data1 = glm::vec4(1, 0, 0, 1);
-		gradient.data.data2 = glm::vec4(0, 0, 1, 1);
+		ComputePushConstants skyData{};
+		skyData.data1 = glm::vec4(0.1, 0.2, 0.4, 0.97);
 
+		if (AddBackgroundEffect("gradient", "./Shaders/Gradient.comp.spv", gradientData)) {
+			//shows the gradient if that one finishes first
+			AddBackgroundEffect("sky", "./Shaders/sky.comp.spv", skyData, backgroundEffects.back().pipeline);
+		}
+		else {
+			AddBackgroundEffect("sky", "./Shaders/sky.comp.spv", skyData);
+		}
+	}
 
-		GEARHEAD_VKSUCCESS_CHECK(vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &gradient.pipeline));
+	bool VkWindow::AddBackgroundEffect(const char* name, const char* shaderPath, const ComputePushConstants& data, PipelineId fallback)
+	{
+		//the engine pushes the effect's data and the frame's right behind it, whether the shader reads all of it or not
+		const ShaderLayout* layout = LoadShaderLayout({ shaderPath }, sizeof(ComputePushConstants) + sizeof(BackgroundPushConstants));
+		if (!layout)
+			return false;
+
+		//effects only get the bindless set, the draw image is a slot in its storage image table
+		const ShaderReflection& reflection = _shaderRegistry.load(shaderPath)->reflection;
+		if (layout->setLayouts.size() != 1 || layout->setLayouts[BINDLESS_SET] != _bindless.layout()) {
+			GEARHEAD_CORE_ERROR("Background effect {0} has to use the bindless set and nothing else", name);
+			return false;
+		}
 
+		ComputeEffect effect{ .name = name, .pipeline = INVALID_PIPELINE, .layout = layout, .localSize = reflection.localSize, .data = data };
+		effect.pipeline = _pipelineCompiler.compile_compute(name, shaderPath, layout->pipelineLayout, fallback);
 
-		ComputeEffect sky = { .name = "sky", .layout = _gradientPipelineLayout, .data = {} };
-		sky.data.data1 = glm::vec4(0.1, 0.2, 0.4, 0.97);
+		backgroundEffects.push_back(effect);
+		return true;
+	}
 
-		GEARHEAD_VKSUCCESS_CHECK(vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &sky.pipeline));
+	void VkWindow::InitMeshPipeline()
+	{
+		_meshLayout = LoadShaderLayout({ "./Shaders/mesh.vert.spv", "./Shaders/mesh.frag.spv" }, sizeof(GPUDrawPushConstants));
+		if (!_meshLayout)
+			return;
 
-		backgroundEffects.push_back(gradient);
-		backgroundEffects.push_back(sky);
+		PipelineBuilder pipelineBuilder;
+		pipelineBuilder.set_layout(_meshLayout->pipelineLayout);
+		//no vertex input, mesh.vert pulls the compact streams itself
+		static_assert(GEOMETRY_VERTEX_FORMAT == VertexFormat::Compact, "mesh.vert only decodes VertexFormat::Compact");
+		pipelineBuilder.set_input_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+		pipelineBuilder.set_polygon_mode(VK_POLYGON_MODE_FILL);
+		//OBJ winding isn't reliable enough to cull on yet
+		pipelineBuilder.set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+		pipelineBuilder.set_multisampling_none();
+		pipelineBuilder.disable_blending();
+		pipelineBuilder.enable_depthtest(true, VK_COMPARE_OP_GREATER_OR_EQUAL);
+
+		pipelineBuilder.set_color_attachment_format(_drawImage.imageFormat);
+		pipelineBuilder.set_depth_format(_depthImage.imageFormat);
+
+		_meshPipeline = _pipelineCompiler.compile_graphics("mesh", pipelineBuilder, "./Shaders/mesh.vert.spv", "./Shaders/mesh.frag.spv");
+	}
 
+	void VkWindow::InitCullPipelines()
+	{
+		_cullLayout = LoadShaderLayout({ "./Shaders/cull.comp.spv" }, sizeof(GPUCullPushConstants));
+		if (_cullLayout) {
+			_cullLocalSize = _shaderRegistry.load("./Shaders/cull.comp.spv")->reflection.localSize;
+			_cullPipeline = _pipelineCompiler.compile_compute("cull", "./Shaders/cull.comp.spv", _cullLayout->pipelineLayout);
+		}
 
-		vkDestroyShaderModule(_device, gradientShader, nullptr);
-		vkDestroyShaderModule(_device, skyShader, nullptr);
+		_depthPyramidLayout = LoadShaderLayout({ "./Shaders/depth_pyramid.comp.spv" }, sizeof(DepthPyramidPushConstants));
+		if (_depthPyramidLayout) {
+			_depthPyramidLocalSize = _shaderRegistry.load("./Shaders/depth_pyramid.comp.spv")->reflection.localSize;
+			_depthPyramidPipeline = _pipelineCompiler.compile_compute("depth pyramid", "./Shaders/depth_pyramid.comp.spv", _depthPyramidLayout->pipelineLayout);
+		}
+	}
 
-		_mainDeletionQueue.push_function([&]() {
-			vkDestroyPipelineLayout(_device, _gradientPipelineLayout, nullptr);
-			vkDestroyPipeline(_device, gradient.pipeline, nullptr);
-			vkDestroyPipeline(_device, sky.pipeline, nullptr);
-			});
+	const ShaderLayout* VkWindow::LoadShaderLayout(std::initializer_list<const char*> paths, uint32_t minPushConstantSize)
+	{
+		std::vector<const ShaderReflection*> reflections;
+		for (const char* path : paths) {
+			std::string error;
+			const ShaderModule* shader = _shaderRegistry.load(path, &error);
+			if (!shader) {
+				GEARHEAD_CORE_ERROR("Failed to load shader: {0}", error);
+				return nullptr;
+			}
+			reflections.push_back(&shader->reflection);
+		}
 
+		//a shader declaring more than the engine pushes would read garbage past the end
+		const ShaderLayout* layout = _layoutCache.pipeline_layout(reflections, minPushConstantSize);
+		if (!layout) {
+			GEARHEAD_CORE_ERROR("No pipeline layout for {0}", *paths.begin());
+			return nullptr;
+		}
+		if (minPushConstantSize > 0 && layout->pushConstantSize > minPushConstantSize) {
+			GEARHEAD_CORE_WARN("{0} declares {1} bytes of push constants, the engine only pushes {2}", *paths.begin(), layout->pushConstantSize, minPushConstantSize);
+		}
+		return layout;
 	}
 
 	void VkWindow::InitImGUI()
@@ -704,8 +1706,8 @@ namespace GearHead {
 		init_info.Device = _device;
 		init_info.Queue = _graphicsQueue;
 		init_info.DescriptorPool = imguiPool;
-		init_info.MinImageCount = 3;
-		init_info.ImageCount = 3;
+		init_info.MinImageCount = DesiredSwapchainImageCount();
+		init_info.ImageCount = (uint32_t)_swapchainImages.size();
 		init_info.UseDynamicRendering = true;
 
 		//dynamic rendering parameters for imgui to use
@@ -727,6 +1729,16 @@ namespace GearHead {
 
 	}
 
+	void VkWindow::CalibrateGpuClock()
+	{
+		//the timestamp executes somewhere between the submit and the end of the wait, call it the middle
+		int64_t before = Profiler::NowUs();
+		ImmediateSubmit([&](VkCommandBuffer cmd) { _gpuProfiler.write_calibration_timestamp(cmd); });
+		int64_t after = Profiler::NowUs();
+
+		_gpuProfiler.calibrate(double(before + after) * 0.5);
+	}
+
 	void VkWindow::ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function) const
 	{
 		GEARHEAD_VKSUCCESS_CHECK(vkResetFences(_device, 1, &_immFence));
@@ -751,13 +1763,192 @@ namespace GearHead {
 	}
 
 
-	void VkWindow::SetVSync(bool enabled) //change when vulkan
+	UploadResult VkWindow::UploadMesh(Mesh& mesh)
 	{
-		if (enabled)
-			glfwSwapInterval(1);
-		else
-			glfwSwapInterval(0);
+		if (mesh._allocation.valid()) {
+			FreeMesh(mesh);
+		}
+
+		//quantize straight into the staging ring, no intermediate copy
+		MeshUploadSpace space;
+		UploadResult result = _meshUploader.reserve((uint32_t)mesh._vertices.size(), (uint32_t)mesh._indices.size(), (uint32_t)mesh._meshlets.size(), mesh._allocation, space);
+		if (result != UploadResult::Uploaded)
+			return result;
+
+		Vertex::encode(GEOMETRY_VERTEX_FORMAT, mesh._vertices, std::span(space.streams.data(), _meshUploader.stream_count()));
+		if (!mesh._indices.empty()) {
+			memcpy(space.indices, mesh._indices.data(), mesh._indices.size() * sizeof(uint32_t));
+		}
+		if (space.meshlets) {
+			memcpy(space.meshlets, mesh._meshlets.data(), mesh._meshlets.size() * sizeof(Meshlet));
+		}
+		_sceneDirty = true;
+		return UploadResult::Uploaded;
+	}
+
+	UploadResult VkWindow::UploadMesh(Mesh& mesh, std::span<const std::span<const uint8_t>> streams, std::span<const uint32_t> indices, std::span<const Meshlet> meshlets)
+	{
+		if (mesh._allocation.valid()) {
+			FreeMesh(mesh);
+		}
+
+		UploadResult result = _meshUploader.upload(streams, indices, meshlets, mesh._allocation);
+		if (result != UploadResult::Uploaded)
+			return result;
+
+		_sceneDirty = true;
+		return UploadResult::Uploaded;
+	}
+
+	void VkWindow::FreeMesh(Mesh& mesh)
+	{
+		if (!mesh._allocation.valid())
+			return;
+
+		// this slot comes around again only after every frame in flight that could draw the mesh is done
+		GetCurrentFrame()._deletionQueue.push_function([this, allocation = mesh._allocation]() { _meshUploader.free(allocation); });
+		mesh._allocation = {};
+		_sceneDirty = true;
+	}
+
+	void VkWindow::LoadMeshAsync(const std::string& path)
+	{
+		_pendingImports.push_back(MeshCache::LoadAsync(path));
+	}
+
+	void VkWindow::PollMeshImports()
+	{
+		GEARHEAD_PROFILE_FUNCTION();
+
+		//take whatever finished parsing, never wait on the ones still running
+		for (size_t i = 0; i < _pendingImports.size();) {
+			if (!IsReady(_pendingImports[i])) {
+				i++;
+				continue;
+			}
+
+			MeshImportResult result = _pendingImports[i].get();
+			_pendingImports.erase(_pendingImports.begin() + i);
+
+			for (ImportedMesh& imported : result.meshes) {
+				_meshesAwaitingUpload.push_back({ _sceneMeshes.size(), result.cache, imported.cacheIndex });
+				_sceneMeshes.push_back(std::move(imported));
+			}
+		}
+
+		//upload in order until the staging ring is full for this frame. Cached meshes go from the
+		//mapping straight into staging, the mapping closes once the last of them is uploaded
+		while (!_meshesAwaitingUpload.empty()) {
+			PendingMeshUpload& pending = _meshesAwaitingUpload.front();
+			Mesh& mesh = _sceneMeshes[pending.sceneMesh].mesh;
+
+			UploadResult uploaded;
+			if (pending.cache) {
+				std::array<std::span<const uint8_t>, MAX_VERTEX_STREAMS> streams;
+				uint32_t streamCount = pending.cache->GetStreamCount();
+				for (uint32_t stream = 0; stream < streamCount; stream++) {
+					streams[stream] = pending.cache->GetVertexData(pending.cacheIndex, stream);
+				}
+				uploaded = UploadMesh(mesh, std::span(streams.data(), streamCount), pending.cache->GetIndexData(pending.cacheIndex),
+					pending.cache->GetMeshletData(pending.cacheIndex));
+			}
+			else {
+				uploaded = UploadMesh(mesh);
+			}
+			if (uploaded == UploadResult::Retry)
+				break;
+
+			//would block every upload queued behind it for good
+			if (uploaded == UploadResult::Rejected) {
+				ImportedMesh& imported = _sceneMeshes[pending.sceneMesh];
+				uint32_t vertexCount = pending.cache ? pending.cache->GetEntry(pending.cacheIndex).vertexCount : (uint32_t)mesh._vertices.size();
+				uint32_t indexCount = pending.cache ? pending.cache->GetEntry(pending.cacheIndex).indexCount : (uint32_t)mesh._indices.size();
+				GEARHEAD_CORE_ERROR("Mesh '{0}' can never be uploaded ({1} vertices, {2} indices), it is empty or larger than the {3} MB staging ring or the geometry buffers ({4} vertices, {5} indices)",
+					imported.name, vertexCount, indexCount, STAGING_BUFFER_SIZE / (1024 * 1024), MAX_GEOMETRY_VERTICES, MAX_GEOMETRY_INDICES);
+				imported.rejected = true;
+				mesh._vertices = {};
+				mesh._indices = {};
+				mesh._meshlets = {};
+			}
+
+			_meshesAwaitingUpload.pop_front();
+		}
+	}
+
+	void VkWindow::SetVSync(bool enabled)
+	{
+		if (mData.vsync == enabled && isInitialized)
+			return;
 
 		mData.vsync = enabled;
+
+		//the present mode is baked into the swapchain, rebuild it before the next frame
+		if (isInitialized)
+			_swapchainDirty = true;
+	}
+
+	void VkWindow::SetLowLatency(bool enabled)
+	{
+		if (_lowLatency == enabled)
+			return;
+
+		_lowLatency = enabled;
+
+		// a single frame in flight and the smallest swapchain keeps at most one frame queued behind the display.
+		// Goes through the same deferral as the slider, the frame ring is only resized between frames
+		if (enabled) {
+			_framesInFlightBeforeLowLatency = _pendingFramesInFlight != 0 ? _pendingFramesInFlight : _framesInFlight;
+			_pendingFramesInFlight = 1;
+		}
+		else {
+			_pendingFramesInFlight = _framesInFlightBeforeLowLatency;
+		}
+
+		if (isInitialized)
+			_swapchainDirty = true;
+	}
+
+	VkPresentModeKHR VkWindow::ChoosePresentMode() const
+	{
+		uint32_t modeCount = 0;
+		GEARHEAD_VKSUCCESS_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(_chosenGPU, _surface, &modeCount, nullptr));
+		std::vector<VkPresentModeKHR> modes(modeCount);
+		GEARHEAD_VKSUCCESS_CHECK(vkGetPhysicalDeviceSurfacePresentModesKHR(_chosenGPU, _surface, &modeCount, modes.data()));
+
+		auto supported = [&](VkPresentModeKHR mode) { return std::find(modes.begin(), modes.end(), mode) != modes.end(); };
+
+		//FIFO is the only mode the spec guarantees
+		if (mData.vsync)
+			return VK_PRESENT_MODE_FIFO_KHR;
+
+		// low latency takes tearing over waiting on a queued image, otherwise mailbox avoids the tearing
+		std::array<VkPresentModeKHR, 2> preference = _lowLatency
+			? std::array{ VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR }
+			: std::array{ VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+
+		for (VkPresentModeKHR mode : preference) {
+			if (supported(mode))
+				return mode;
+		}
+
+		GEARHEAD_CORE_WARN("No tearing present mode available, staying on FIFO");
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+
+	uint32_t VkWindow::DesiredSwapchainImageCount() const
+	{
+		//vk-bootstrap clamps this to what the surface supports
+		return _lowLatency ? 2U : 3U;
+	}
+
+	const char* VkWindow::PresentModeName(VkPresentModeKHR mode)
+	{
+		switch (mode) {
+		case VK_PRESENT_MODE_IMMEDIATE_KHR: return "Immediate";
+		case VK_PRESENT_MODE_MAILBOX_KHR: return "Mailbox";
+		case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+		case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO Relaxed";
+		default: return "Unknown";
+		}
 	}
 }
@@ -7,6 +7,17 @@
 #include <Core/Window.hpp>
 
 #include "VkDescriptors.hpp"
+#include "VkBindless.hpp"
+#include "VkProfiler.hpp"
+#include "VkPipelineCache.hpp"
+#include "VkPipelineCompiler.hpp"
+#include "VkShaderRegistry.hpp"
+#include "VkLayoutCache.hpp"
+#include "VkShaderReload.hpp"
+#include "VkUpload.hpp"
+#include "Game/Components/Primitives/Mesh.hpp"
+#include "Game/Assets/MeshCache.hpp"
+#include "Core/Profiler.hpp"
 
 namespace GearHead {
 
@@ -35,11 +46,110 @@ namespace GearHead {
 		glm::vec4 data4;
 	};
 
+	// engine owned, pushed right after the effect's ComputePushConstants
+	struct BackgroundPushConstants {
+		glm::ivec2 drawExtent;
+		//storage image table slot to write to
+		uint32_t drawImageIndex;
+	};
+
+	// mesh.vert, 128 bytes is all the push constant space every device guarantees. The pointers are
+	// device addresses of the compact vertex streams and the frame's GPUInstance array
+	struct GPUDrawPushConstants {
+		glm::mat4 viewProj;
+		VkDeviceAddress positions;
+		VkDeviceAddress attributes;
+		VkDeviceAddress instances;
+	};
+
+	// one per scene mesh, cull.comp turns the ones that survive into draws that pick it again by firstInstance
+	struct GPUInstance {
+		glm::mat4 model;
+		//xyz center in mesh space, w radius
+		glm::vec4 boundingSphere;
+		//copied into the draw command
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		//range in the geometry meshlet buffer, a visible instance with meshlets is culled again one cluster at a time
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+		uint32_t pad[3];
+	};
+
+	// cull.comp, a camera the instances get tested against
+	struct GPUCullView {
+		glm::mat4 view;
+		//P00, P11, P22, P32 of the projection, enough for a symmetric perspective
+		glm::vec4 projection;
+		float znear;
+		float zfar;
+		float pad[2];
+	};
+
+	constexpr uint32_t CULL_FRUSTUM = 1u << 0;
+	constexpr uint32_t CULL_OCCLUSION = 1u << 1;
+	//split visible instances that have meshlets into one draw per visible meshlet
+	constexpr uint32_t CULL_CLUSTERS = 1u << 2;
+	//drop meshlets whose normal cone faces away from the camera
+	constexpr uint32_t CULL_BACKFACE = 1u << 3;
+
+	//cull.comp runs twice, one invocation per instance then one workgroup per instance queued for cluster culling
+	constexpr uint32_t CULL_PASS_INSTANCES = 0;
+	constexpr uint32_t CULL_PASS_CLUSTERS = 1;
+
+	// cull.comp, written to the frame's cull data buffer
+	struct GPUCullData {
+		GPUCullView view;
+		//last frame's camera, the one the depth pyramid was rendered from
+		GPUCullView pyramidView;
+		//draw extent the pyramid was built from, and how many of its levels that filled
+		glm::uvec2 pyramidExtent;
+		uint32_t pyramidIndex;
+		uint32_t pyramidLevels;
+		uint32_t instanceCount;
+		//CULL_ bits
+		uint32_t flags;
+		//room in the draw command buffer, anything past it is dropped
+		uint32_t maxDraws;
+		uint32_t pad;
+	};
+
+	// cull.comp
+	struct GPUCullPushConstants {
+		VkDeviceAddress cullData;
+		VkDeviceAddress instances;
+		VkDeviceAddress meshlets;
+		VkDeviceAddress clusterWork;
+		VkDeviceAddress drawCommands;
+		VkDeviceAddress drawCount;
+		//CULL_PASS_
+		uint32_t pass;
+	};
+
+	// cull.comp, head of the frame's cluster work buffer, followed by the uint indices of the instances queued
+	// for cluster culling. The instance pass counts them into the dispatch the cluster pass is launched with
+	struct GPUClusterWork {
+		VkDispatchIndirectCommand dispatch;
+		//every instance that tried to queue, including the ones past MAX_CLUSTER_INSTANCES that got drawn whole
+		uint32_t queued;
+	};
+
+	// depth_pyramid.comp, one dispatch per level. Indices are bindless slots
+	struct DepthPyramidPushConstants {
+		glm::ivec2 srcSize;
+		glm::ivec2 dstSize;
+		uint32_t srcIndex;
+		uint32_t dstIndex;
+	};
+
 	struct ComputeEffect {
 		const char* name;
 
-		VkPipeline pipeline;
-		VkPipelineLayout layout;
+		PipelineId pipeline;
+		//reflected from the shader, owned by the layout cache
+		const ShaderLayout* layout;
+		std::array<uint32_t, 3> localSize;
 
 		ComputePushConstants data;
 	};
@@ -48,15 +158,100 @@ namespace GearHead {
 	struct FrameData {
 		VkCommandPool _pool;
 		VkCommandBuffer _buffer;
+		//only used when the device has a separate compute queue
+		VkCommandPool _computePool{ VK_NULL_HANDLE };
+		VkCommandBuffer _computeBuffer{ VK_NULL_HANDLE };
 		VkSemaphore _SwapChainSemaphore, _renderSemaphore;
-		VkFence _renderFence;
+		//graphics timeline value signalled by this frame's submit
+		uint64_t _timelineValue{ 0 };
 		DeletionQueue _deletionQueue;
+		//reset as a whole once the frame's timeline value has passed
+		DescriptorAllocator _frameDescriptors;
+		//persistently mapped, MAX_SCENE_INSTANCES of them. Only rewritten when the scene changed since
+		//this slot last went out, so a static scene costs no cpu time per instance
+		AllocatedBuffer _instanceBuffer;
+		uint64_t _instanceVersion{ 0 };
+		//persistently mapped GPUCullData
+		AllocatedBuffer _cullDataBuffer;
+		//written by cull.comp, one VkDrawIndexedIndirectCommand per instance or meshlet that survived and their count
+		AllocatedBuffer _drawCommandBuffer;
+		AllocatedBuffer _drawCountBuffer;
+		//GPUClusterWork, only touched by the cull pass
+		AllocatedBuffer _clusterWorkBuffer;
+	};
+
+	struct FrameStats {
+		float frameTimeMs{ 0.f };
+		float avgFrameTimeMs{ 0.f };
+		//cpu time blocked waiting on the gpu for a free frame slot
+		float frameWaitMs{ 0.f };
+		float avgFrameWaitMs{ 0.f };
+		uint32_t framesInFlight{ 0 };
+
+		//gpu time spent on the draw image (background effects and scene), compute queue included.
+		//the swapchain blit and ImGUI are left out since they wait on the display
+		float gpuFrameMs{ 0.f };
+		float avgGpuFrameMs{ 0.f };
+
+		//cpu side present-to-present interval
+		static constexpr int HISTORY_SIZE = 120;
+		float presentIntervalMs{ 0.f };
+		float avgPresentIntervalMs{ 0.f };
+		float presentHistory[HISTORY_SIZE]{};
+		int presentHistoryOffset{ 0 };
+	};
+
+
+
+	struct StartupStats {
+		float initMs{ 0.f };
+		float pipelineMs{ 0.f };
+		//pipelines were created from a cache loaded off disk
+		bool warmPipelineCache{ false };
+	};
+
+	enum class RenderScaleMode {
+		Fixed,
+		// driven towards a gpu frame time target
+		Dynamic
+	};
+
+	constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4U;
+	constexpr uint32_t MAX_SCENE_INSTANCES = 128U * 1024U;
+	//enough for a 65536 pixel wide draw image
+	constexpr uint32_t MAX_DEPTH_PYRAMID_LEVELS = 16U;
+
+	//descriptors per set in every pool the renderer's allocators make
+	constexpr DescriptorAllocator::PoolSizeRatio DESCRIPTOR_POOL_RATIOS[] = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f },
 	};
 
+	constexpr float MIN_RENDER_SCALE = 0.25f;
 
+	//gpu profiler scope covering everything written to the draw image, drives the dynamic render scale
+	constexpr const char* GPU_SCOPE_DRAW_IMAGE = "Draw Image";
+	constexpr uint64_t FRAME_WAIT_TIMEOUT_NS = 1000000000;
 
+	//reverse z, cleared to 0 and tested with GREATER_OR_EQUAL
+	constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
 
-	constexpr unsigned int FRAME_OVERLAP = 2U;
+	//next to the executable's working directory, like the profiler output
+	constexpr const char* PIPELINE_CACHE_PATH = "GearHead_pipelines.cache";
+	constexpr std::chrono::seconds PIPELINE_CACHE_SAVE_INTERVAL{ 30 };
+
+	//mesh streaming budgets
+	constexpr size_t STAGING_BUFFER_SIZE = 32 * 1024 * 1024;
+	constexpr uint32_t MAX_GEOMETRY_VERTICES = 2 * 1024 * 1024;
+	constexpr uint32_t MAX_GEOMETRY_INDICES = 6 * 1024 * 1024;
+	constexpr uint32_t MAX_GEOMETRY_MESHLETS = 64 * 1024;
+
+	//every instance drawn whole plus every meshlet drawn on its own
+	constexpr uint32_t MAX_SCENE_DRAWS = MAX_SCENE_INSTANCES + MAX_GEOMETRY_MESHLETS;
+	//the smallest maxComputeWorkGroupCount[0] devices have to support, instances past it get drawn whole
+	constexpr uint32_t MAX_CLUSTER_INSTANCES = 65535U;
 
 	class GEARHEAD_API VkWindow : public Window {
 	public:
@@ -79,7 +274,41 @@ namespace GearHead {
 
 		bool IsVSync() const override { return mData.vsync; }
 
-	private:
+		// Latency over throughput: one frame in flight, minimal swapchain, immediate present when vsync is off
+		void SetLowLatency(bool enabled);
+		bool IsLowLatency() const { return _lowLatency; }
+
+		// 1 - MAX_FRAMES_IN_FLIGHT, waits for the gpu to go idle
+		void SetFramesInFlight(uint32_t count);
+		uint32_t GetFramesInFlight() const { return _framesInFlight; }
+
+		const FrameStats& GetFrameStats() const { return _frameStats; }
+		const StartupStats& GetStartupStats() const { return _startupStats; }
+		const GpuProfiler& GetGpuProfiler() const { return _gpuProfiler; }
+		GpuProfiler& GetGpuProfiler() { return _gpuProfiler; }
+
+		// Renders into a fraction of the draw image and upscales it in the blit to the swapchain
+		void SetRenderScale(float scale);
+		// Adjusts the render scale every frame to hold the gpu frame time at the target
+		void SetDynamicRenderScale(float targetGpuFrameMs);
+		float GetRenderScale() const { return _renderScale; }
+
+		// Encodes the mesh into the staging ring in GEOMETRY_VERTEX_FORMAT, the GPU copy is recorded at the start
+		// of the next frame. Retry when this frame's staging budget is used up, call again next frame. Rejected when
+		// the mesh can never fit
+		UploadResult UploadMesh(Mesh& mesh);
+		// Same, with already encoded streams (one per stream of the format) and meshlets from somewhere other than the mesh, e.g. a mapped cache file
+		UploadResult UploadMesh(Mesh& mesh, std::span<const std::span<const uint8_t>> streams, std::span<const uint32_t> indices, std::span<const Meshlet> meshlets = {});
+		// Releases the mesh's geometry once the frames that could still draw it are done
+		void FreeMesh(Mesh& mesh);
+
+		// Loads the OBJ (or its .ghmesh cache) on the thread pool, its meshes join the scene and upload once it finishes
+		void LoadMeshAsync(const std::string& path);
+
+	protected:
+		//only for derived backends that drive their own Init (e.g. headless)
+		VkWindow() = default;
+
 // Methods
 		virtual void Init(const WindowProps& props);
 		virtual void Shutdown();
@@ -87,16 +316,51 @@ namespace GearHead {
 		//Vulkan Inits
 		void InitVulkan();
 		void InitSwapchain();
+		void InitDrawImage();
+		void CreateDrawImage(VkExtent2D extent);
+		void DestroyDrawImage();
+		void GrowDrawImage(VkExtent2D extent);
 		void InitCommands();
+		void InitGeometry();
+		void PollMeshImports();
+		//rebuilds the instances when meshes came or went, then fills in this frame's instance and cull buffers
+		void UpdateScene();
+		void InitFrames();
+		void DestroyFrames();
 		void InitSyncStructures();
 		void InitDescriptors();
+		void InitPipelineCache();
+		void SavePipelineCache();
 		void InitPipelines();
+		//wait blocks until everything queued has compiled
+		void PollPipelines(bool wait = false);
+		void InitShaderHotReload();
 		void InitBackgroundPipelines();
+		void InitMeshPipeline();
+		void InitCullPipelines();
+		//reflects the shaders through the registry, nullptr if any of them doesn't load
+		const ShaderLayout* LoadShaderLayout(std::initializer_list<const char*> paths, uint32_t minPushConstantSize = 0);
+		bool AddBackgroundEffect(const char* name, const char* shaderPath, const ComputePushConstants& data, PipelineId fallback = INVALID_PIPELINE);
 		void InitImGUI();
 
 
+		//Frame pacing
+		void WaitForFrame(FrameData& frame);
+		void CalibrateGpuClock();
+		void UpdateRenderScale(float gpuFrameMs);
+		//the part of the draw image a frame for a target of this size renders to, shared by every window kind
+		VkExtent2D ScaledDrawExtent(VkExtent2D target) const;
+
 		//Draw Calls
+		void DrawScene(VkCommandBuffer cmd);
+		void RecordComputePass(VkCommandBuffer cmd);
+		VkSemaphoreSubmitInfo SubmitComputePass();
 		void DrawBackground(VkCommandBuffer cmd);
+		//instances -> indirect draws, recorded next to the background on whichever queue runs it
+		void CullScene(VkCommandBuffer cmd);
+		void DrawGeometry(VkCommandBuffer cmd);
+		void BuildDepthPyramid(VkCommandBuffer cmd);
+		void BuildImGUI();
 		void DrawImGUI(VkCommandBuffer cmd, VkImageView targetImageView) const;
 
 
@@ -104,6 +368,9 @@ namespace GearHead {
 		void CreateSwapChain(uint32_t width, uint32_t height);
 		void DestroySwapChain();
 		void RebuildSwapChain();
+		VkPresentModeKHR ChoosePresentMode() const;
+		uint32_t DesiredSwapchainImageCount() const;
+		static const char* PresentModeName(VkPresentModeKHR mode);
 
 		//Immediate Sumbit
 		void ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function) const;
@@ -121,7 +388,8 @@ namespace GearHead {
 			}
 		};
 
-		GLFWwindow* _window;
+		GLFWwindow* _window{ nullptr };
+		bool _headless{ false };
 
 		WindowData mData;
 		DeletionQueue _mainDeletionQueue;
@@ -132,45 +400,150 @@ namespace GearHead {
 		int _frameNumber{ 0 };
 
 		//Device 
-		VkInstance _instance;
-		VkDebugUtilsMessengerEXT _debugMessenger;
-		VkPhysicalDevice _chosenGPU;
-		VkDevice _device;
-		VkSurfaceKHR _surface;
+		VkInstance _instance{ VK_NULL_HANDLE };
+		VkDebugUtilsMessengerEXT _debugMessenger{ VK_NULL_HANDLE };
+		VkPhysicalDevice _chosenGPU{ VK_NULL_HANDLE };
+		VkDevice _device{ VK_NULL_HANDLE };
+		VkSurfaceKHR _surface{ VK_NULL_HANDLE };
 
 		//Swapchain 
-		VkSwapchainKHR _swapchain;
+		VkSwapchainKHR _swapchain{ VK_NULL_HANDLE };
 		VkFormat _swapchainImageFormat;
 		std::vector<VkImage> _swapchainImages;
 		std::vector<VkImageView> _swapchainImageViews;
 		VkExtent2D _swapchainExtent;
+		VkPresentModeKHR _presentMode{ VK_PRESENT_MODE_FIFO_KHR };
+		bool _lowLatency{ false };
+		bool _swapchainDirty{ false };
+		std::chrono::high_resolution_clock::time_point _lastPresent{};
 		
 		//Commands
 		VkQueue _graphicsQueue;
 		uint32_t _graphicsQueueFamily;
-		FrameData _frames[FRAME_OVERLAP];
 
-		FrameData& GetCurrentFrame() { return _frames[_frameNumber % FRAME_OVERLAP]; }	
-
-		//Render Pass
-		VkRenderPass _renderPass;
-		std::vector<VkFramebuffer> _frameBuffers;
+		//Async compute. Background effects go here when the device exposes a queue family separate from graphics
+		bool _asyncCompute{ false };
+		VkQueue _computeQueue{ VK_NULL_HANDLE };
+		uint32_t _computeQueueFamily{ 0 };
+
+		// compute -> graphics: the draw image has been written
+		VkSemaphore _computeTimeline{ VK_NULL_HANDLE };
+		uint64_t _computeTimelineValue{ 0 };
+		// graphics -> compute: the draw image has been blitted and can be overwritten
+		VkSemaphore _blitTimeline{ VK_NULL_HANDLE };
+		uint64_t _blitTimelineValue{ 0 };
+		std::vector<FrameData> _frames;
+		uint32_t _framesInFlight{ 2 };
+		uint32_t _pendingFramesInFlight{ 0 };
+		//restored when low latency is turned off
+		uint32_t _framesInFlightBeforeLowLatency{ 2 };
+
+		uint32_t GetCurrentFrameIndex() const { return _frameNumber % _framesInFlight; }
+		FrameData& GetCurrentFrame() { return _frames[GetCurrentFrameIndex()]; }	
+		FrameData& GetPreviousFrame() { return _frames[(_frameNumber + _framesInFlight - 1) % _framesInFlight]; }
+
+		// graphics queue timeline, one value per submitted frame
+		VkSemaphore _graphicsTimeline{ VK_NULL_HANDLE };
+		uint64_t _graphicsTimelineValue{ 0 };
+
+		FrameStats _frameStats;
+		StartupStats _startupStats;
+		std::chrono::high_resolution_clock::time_point _lastFrameStart{};
 
 		//Descriptor Sets
 		DescriptorAllocator GlobalDescriptorAllocator;
+		BindlessHeap _bindless;
+		uint32_t _drawImageIndex{ INVALID_BINDLESS_INDEX };
 
-		VkDescriptorSet _drawImageDescriptors;
-		VkDescriptorSetLayout _drawImageDescriptorLayout;
 
 		//VMA Allocator
 		VmaAllocator _allocator;
 
 		AllocatedImage _drawImage;
+		//same size as the draw image, kept after the geometry pass for the depth pyramid
+		AllocatedImage _depthImage;
+		uint32_t _depthImageIndex{ INVALID_BINDLESS_INDEX };
+
+		//farthest depth of last frame's geometry for occlusion culling. Mip 0 covers the draw extent at half
+		//resolution, each level after halves the one before rounding up. The image is a power of two so
+		//every draw extent up to the draw image fits
+		AllocatedImage _depthPyramid;
+		uint32_t _depthPyramidMipCount{ 0 };
+		std::array<VkImageView, MAX_DEPTH_PYRAMID_LEVELS> _depthPyramidMips{};
+		//whole mip chain for cull.comp, then each mip for the build to write and read back
+		uint32_t _depthPyramidIndex{ INVALID_BINDLESS_INDEX };
+		//slots below _depthPyramidMipCount, the count only grows with the draw image
+		std::array<uint32_t, MAX_DEPTH_PYRAMID_LEVELS> _depthPyramidStorageIndices{};
+		std::array<uint32_t, MAX_DEPTH_PYRAMID_LEVELS> _depthPyramidSampledIndices{};
+		//what the last build saw, occlusion culling stays off until there has been one
+		bool _depthPyramidValid{ false };
+		GPUCullView _depthPyramidView{};
+		VkExtent2D _depthPyramidExtent{};
 		VkExtent2D _drawExtent;		
 
+		//Render scale
+		RenderScaleMode _renderScaleMode{ RenderScaleMode::Fixed };
+		float _renderScale{ 1.f };
+		float _targetGpuFrameMs{ 16.f };
+
+		//Geometry
+		MeshUploader _meshUploader;
+		struct PendingMeshUpload {
+			size_t sceneMesh;
+			//streams are read from here when set, otherwise from the mesh itself
+			std::shared_ptr<const MeshCacheFile> cache;
+			uint32_t cacheIndex;
+		};
+
+		std::vector<std::future<MeshImportResult>> _pendingImports;
+		std::vector<ImportedMesh> _sceneMeshes;
+		//GPU copy of every uploaded indexed mesh, rebuilt only when _sceneDirty
+		std::vector<GPUInstance> _sceneInstances;
+		uint64_t _sceneVersion{ 0 };
+		bool _sceneDirty{ false };
+		glm::vec3 _sceneCenter{ 0.f };
+		float _sceneRadius{ 1.f };
+		//this frame's camera
+		GPUCullView _sceneView{};
+		glm::mat4 _sceneViewProj{ 1.f };
+		//still waiting for staging space
+		std::deque<PendingMeshUpload> _meshesAwaitingUpload;
+		char _importPath[256]{};
+
+		//GPU profiling
+		GpuProfiler _gpuProfiler;
+		uint32_t _drawImageScope{ 0 };
+		uint64_t _lastResolvedGpuFrame{ ~0ull };
+
 		//Pipelines
-		VkPipeline _gradientPipeline;
-		VkPipelineLayout _gradientPipelineLayout;
+		PipelineCache _pipelineCache;
+		ShaderRegistry _shaderRegistry;
+		LayoutCache _layoutCache;
+		PipelineCompiler _pipelineCompiler;
+		ShaderHotReloader _shaderReloader;
+		std::chrono::high_resolution_clock::time_point _lastPipelineCacheSave{};
+
+		PipelineId _meshPipeline{ INVALID_PIPELINE };
+		const ShaderLayout* _meshLayout{ nullptr };
+
+		//Culling
+		PipelineId _cullPipeline{ INVALID_PIPELINE };
+		const ShaderLayout* _cullLayout{ nullptr };
+		std::array<uint32_t, 3> _cullLocalSize{ 1, 1, 1 };
+		PipelineId _depthPyramidPipeline{ INVALID_PIPELINE };
+		const ShaderLayout* _depthPyramidLayout{ nullptr };
+		std::array<uint32_t, 3> _depthPyramidLocalSize{ 1, 1, 1 };
+		bool _frustumCulling{ true };
+		bool _occlusionCulling{ true };
+		bool _clusterCulling{ true };
+		bool _backfaceCulling{ true };
+		//this frame's cull pass was recorded, geometry only draws from its output
+		bool _sceneCulled{ false };
+
+		//orbits the bounds of everything uploaded so far
+		float _cameraYaw{ 0.f };
+		float _cameraPitch{ 20.f };
+		float _cameraDistance{ 2.5f };
 
 		//ImGUI
 		VkFence _immFence;
@@ -17,12 +17,21 @@
 #include <unordered_set>
 #include <stdexcept>
 #include <span>
+#include <array>
 #include <fstream>
+#include <chrono>
+#include <thread>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
 
 #include "Core/Log.hpp"
 
 
 #ifdef GEARHEAD_PLATFORM_WINDOWS
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <Windows.h>
 #endif // GEARHEAD_PLATFORM_WINDOWS
 